@@ -153,6 +153,74 @@ void dxGetResetCommand(DX_UINT8 *command,    // buffer to put the resulting comm
 
 
 
+//------------------------------------------------------------------------------------------------------
+// Write the same area of the Control Table of several servos with one broadcast packet.
+void dxGetSyncWriteCommand(DX_UINT8 *command,        // buffer to put the resulting command string
+                           DX_UINT8 *size,           // length of the resulting command string
+                           DX_UINT8  startingAdress, // starting adress of write
+                           DX_UINT8  dataSize,       // length of data to write per servo
+                           const DX_UINT8 *ids,      // Servos which should be adressed
+                           const DX_UINT8 *data,     // data to write, dataSize bytes per servo in the order of ids
+                           DX_UINT8  count)          // number of servos
+{
+  command[0] = 255;                        // start of packet
+  command[1] = 255;                        // start of packet
+  command[2] = DX_BROADCAST;               // sync write is always broadcasted
+  command[3] = (dataSize + 1) * count + 4; // length of packet (parametercount + 2)
+  command[4] = DX_SYNC_WRITE;              // instruction
+  command[5] = startingAdress;             // parameter 1
+  command[6] = dataSize;                   // parameter 2
+  DX_UINT8 i, j;
+  DX_UINT8 pos = 7;
+  for (i = 0; i < count; i++)
+  {
+    command[pos++] = ids[i];               // id of servo i
+    for (j = 0; j < dataSize; j++)
+      command[pos++] = data[i * dataSize + j]; // data of servo i
+  }
+  DX_UINT8 check = command[2];
+  for (i = 3; i < pos; i++)
+    check += command[i];
+  command[pos] = ~check; // checksum
+  *size = pos + 1;
+}
+
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Read areas of the Control Table of several servos with one broadcast packet (MX series).
+void dxGetBulkReadCommand(DX_UINT8 *command,                 // buffer to put the resulting command string
+                          DX_UINT8 *size,                    // length of the resulting command string
+                          const DX_UINT8 *ids,               // Servos which should be adressed
+                          const DX_UINT8 *startingAdresses,  // starting adress of read per servo
+                          const DX_UINT8 *dataLengths,       // length of data to read per servo
+                          DX_UINT8  count)                   // number of servos
+{
+  command[0] = 255;                        // start of packet
+  command[1] = 255;                        // start of packet
+  command[2] = DX_BROADCAST;               // bulk read is always broadcasted
+  command[3] = 3 * count + 3;              // length of packet (parametercount + 2)
+  command[4] = DX_BULK_READ;               // instruction
+  command[5] = 0;                          // parameter 1, always 0
+  DX_UINT8 i;
+  DX_UINT8 pos = 6;
+  for (i = 0; i < count; i++)
+  {
+    command[pos++] = dataLengths[i];       // length of data of servo i
+    command[pos++] = ids[i];               // id of servo i
+    command[pos++] = startingAdresses[i];  // starting adress of servo i
+  }
+  DX_UINT8 check = command[2];
+  for (i = 3; i < pos; i++)
+    check += command[i];
+  command[pos] = ~check; // checksum
+  *size = pos + 1;
+}
+
+
+
+
 //------------------------------------------------------------------------------------------------------
 // returns true if checksum is ok
 DX_BOOL dxIsStatusValid(const DX_UINT8 *status, DX_UINT8 size)       // buffer containing the status packet
@@ -365,7 +433,7 @@ void dxGetRegWriteItemCommand(DX_UINT8 *command,        // buffer to put the res
                               DX_UINT16 item,           // item to write , see memory defines above
                               DX_UINT16 value)          // value of item
 {
-  dxGetWriteCommand(command,size,id,(item & 0xff),(DX_UINT8*)(&value),(item & 0xff00) >> 8);
+  dxGetRegWriteCommand(command,size,id,(item & 0xff),(DX_UINT8*)(&value),(item & 0xff00) >> 8);
 }
 
 
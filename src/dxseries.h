@@ -33,6 +33,8 @@
 #define DX_REGWRITE 0x04
 #define DX_ACTION   0x05
 #define DX_RESET    0x06
+#define DX_SYNC_WRITE 0x83
+#define DX_BULK_READ  0x92
 
 // error bits
 #define DX_INPUT_VOLTAGE_ERROR 0x01
@@ -42,6 +44,8 @@
 #define DX_CHECKSUM_ERROR      0x10
 #define DX_OVERLOAD_ERROR      0x20
 #define DX_INSTRUCTION_ERROR   0x40
+// bits of a servo rejecting the instruction, the others report a lasting state of the servo
+#define DX_REJECTION_ERRORS    (DX_RANGE_ERROR | DX_CHECKSUM_ERROR | DX_INSTRUCTION_ERROR)
 
 // status return level
 #define DX_NO_RESPONE    0x00
@@ -325,6 +329,27 @@ void dxGetResetCommand(DX_UINT8 *command,    // buffer to put the resulting comm
                        DX_UINT8 *size,       // length of the resulting command string
                        DX_UINT8  id);        // Servo which should be adressed
 
+// Write the same area of the Control Table of several servos with one broadcast packet.
+// No status packet will be returned. The resulting command must not exceed 255 bytes,
+// so count * (dataSize + 1) has to be smaller or equal than 247.
+void dxGetSyncWriteCommand(DX_UINT8 *command,        // buffer to put the resulting command string
+                           DX_UINT8 *size,           // length of the resulting command string
+                           DX_UINT8  startingAdress, // starting adress of write
+                           DX_UINT8  dataSize,       // length of data to write per servo
+                           const DX_UINT8 *ids,      // Servos which should be adressed
+                           const DX_UINT8 *data,     // data to write, dataSize bytes per servo in the order of ids
+                           DX_UINT8  count);         // number of servos
+
+// Read areas of the Control Table of several servos with one broadcast packet (MX series).
+// Every servo answers with its own status packet, in the order of ids. The resulting
+// command must not exceed 255 bytes, so count has to be smaller or equal than 82.
+void dxGetBulkReadCommand(DX_UINT8 *command,                 // buffer to put the resulting command string
+                          DX_UINT8 *size,                    // length of the resulting command string
+                          const DX_UINT8 *ids,               // Servos which should be adressed
+                          const DX_UINT8 *startingAdresses,  // starting adress of read per servo
+                          const DX_UINT8 *dataLengths,       // length of data to read per servo
+                          DX_UINT8  count);                  // number of servos
+
 
 //------------------------------------------------------------------------------------------------------
 // status packet parsing
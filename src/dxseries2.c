@@ -0,0 +1,405 @@
+/*
+ *  Robotis Dynamixel Protocol 2.0 Control Library
+ *
+ *  The library generates the appropriate Protocol 2.0 command strings
+ *  which then should be sent by the accordant usart commands of the
+ *  actually used system.
+ *
+ */
+
+
+#include "dxseries2.h"
+
+//------------------------------------------------------------------------------------------------------
+// CRC-16 (polynomial 0x8005) lookup table, one entry per value of the high crc byte xor the data byte
+static const DX_UINT16 dx2CRCTable[256] = {
+  0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011,
+  0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022,
+  0x8063, 0x0066, 0x006C, 0x8069, 0x0078, 0x807D, 0x8077, 0x0072,
+  0x0050, 0x8055, 0x805F, 0x005A, 0x804B, 0x004E, 0x0044, 0x8041,
+  0x80C3, 0x00C6, 0x00CC, 0x80C9, 0x00D8, 0x80DD, 0x80D7, 0x00D2,
+  0x00F0, 0x80F5, 0x80FF, 0x00FA, 0x80EB, 0x00EE, 0x00E4, 0x80E1,
+  0x00A0, 0x80A5, 0x80AF, 0x00AA, 0x80BB, 0x00BE, 0x00B4, 0x80B1,
+  0x8093, 0x0096, 0x009C, 0x8099, 0x0088, 0x808D, 0x8087, 0x0082,
+  0x8183, 0x0186, 0x018C, 0x8189, 0x0198, 0x819D, 0x8197, 0x0192,
+  0x01B0, 0x81B5, 0x81BF, 0x01BA, 0x81AB, 0x01AE, 0x01A4, 0x81A1,
+  0x01E0, 0x81E5, 0x81EF, 0x01EA, 0x81FB, 0x01FE, 0x01F4, 0x81F1,
+  0x81D3, 0x01D6, 0x01DC, 0x81D9, 0x01C8, 0x81CD, 0x81C7, 0x01C2,
+  0x0140, 0x8145, 0x814F, 0x014A, 0x815B, 0x015E, 0x0154, 0x8151,
+  0x8173, 0x0176, 0x017C, 0x8179, 0x0168, 0x816D, 0x8167, 0x0162,
+  0x8123, 0x0126, 0x012C, 0x8129, 0x0138, 0x813D, 0x8137, 0x0132,
+  0x0110, 0x8115, 0x811F, 0x011A, 0x810B, 0x010E, 0x0104, 0x8101,
+  0x8303, 0x0306, 0x030C, 0x8309, 0x0318, 0x831D, 0x8317, 0x0312,
+  0x0330, 0x8335, 0x833F, 0x033A, 0x832B, 0x032E, 0x0324, 0x8321,
+  0x0360, 0x8365, 0x836F, 0x036A, 0x837B, 0x037E, 0x0374, 0x8371,
+  0x8353, 0x0356, 0x035C, 0x8359, 0x0348, 0x834D, 0x8347, 0x0342,
+  0x03C0, 0x83C5, 0x83CF, 0x03CA, 0x83DB, 0x03DE, 0x03D4, 0x83D1,
+  0x83F3, 0x03F6, 0x03FC, 0x83F9, 0x03E8, 0x83ED, 0x83E7, 0x03E2,
+  0x83A3, 0x03A6, 0x03AC, 0x83A9, 0x03B8, 0x83BD, 0x83B7, 0x03B2,
+  0x0390, 0x8395, 0x839F, 0x039A, 0x838B, 0x038E, 0x0384, 0x8381,
+  0x0280, 0x8285, 0x828F, 0x028A, 0x829B, 0x029E, 0x0294, 0x8291,
+  0x82B3, 0x02B6, 0x02BC, 0x82B9, 0x02A8, 0x82AD, 0x82A7, 0x02A2,
+  0x82E3, 0x02E6, 0x02EC, 0x82E9, 0x02F8, 0x82FD, 0x82F7, 0x02F2,
+  0x02D0, 0x82D5, 0x82DF, 0x02DA, 0x82CB, 0x02CE, 0x02C4, 0x82C1,
+  0x8243, 0x0246, 0x024C, 0x8249, 0x0258, 0x825D, 0x8257, 0x0252,
+  0x0270, 0x8275, 0x827F, 0x027A, 0x826B, 0x026E, 0x0264, 0x8261,
+  0x0220, 0x8225, 0x822F, 0x022A, 0x823B, 0x023E, 0x0234, 0x8231,
+  0x8213, 0x0216, 0x021C, 0x8219, 0x0208, 0x820D, 0x8207, 0x0202
+};
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Updates the CRC-16 (polynomial 0x8005) with size bytes of data, start with crc = 0.
+DX_UINT16 dx2UpdateCRC(DX_UINT16 crc,            // crc of the preceding data
+                       const DX_UINT8 *data,     // data to add
+                       DX_UINT16 size)           // number of bytes
+{
+  DX_UINT16 i;
+  for (i = 0; i < size; i++)
+    crc = (DX_UINT16)(crc << 8) ^ dx2CRCTable[((crc >> 8) ^ data[i]) & 0xFF];
+  return crc;
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Copies size parameters to command[pos], 0xFF 0xFF 0xFD gets an additional 0xFD. ffCount holds the
+// number of 0xFF preceding the data (0 to 2), so the header is never examined. Returns the new pos.
+static DX_UINT16 dx2CopyStuffed(DX_UINT8 *command, DX_UINT16 pos, const DX_UINT8 *data,
+                                DX_UINT16 size, DX_UINT8 *ffCount)
+{
+  DX_UINT16 i;
+  for (i = 0; i < size; i++)
+  {
+    command[pos++] = data[i];
+    if (data[i] == 0xFD && *ffCount == 2)
+      command[pos++] = 0xFD;
+    *ffCount = data[i] != 0xFF ? 0 : *ffCount < 2 ? *ffCount + 1 : 2;
+  }
+  return pos;
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Builds an instruction packet, the parameters are byte stuffed.
+void dx2GetCommand(DX_UINT8 *command,           // buffer to put the resulting command string
+                   DX_UINT16 *size,             // length of the resulting command string
+                   DX_UINT8  id,                // Servo which should be adressed
+                   DX_UINT8  instruction,       // instruction, see defines above
+                   const DX_UINT8 *params,      // parameters of the instruction
+                   DX_UINT16 paramCount)        // number of parameters
+{
+  command[0] = 0xFF;                   // start of packet
+  command[1] = 0xFF;                   // start of packet
+  command[2] = 0xFD;                   // start of packet
+  command[3] = 0x00;                   // reserved
+  command[4] = id;                     // id of recipient
+  command[7] = instruction;            // instruction
+  DX_UINT8 ffCount = 0;
+  DX_UINT16 pos = dx2CopyStuffed(command, 8, params, paramCount, &ffCount);
+  DX_UINT16 length = pos - 8 + 3;      // length of packet (instruction + parameters + crc)
+  command[5] = length & 0xFF;
+  command[6] = (length >> 8) & 0xFF;
+  DX_UINT16 crc = dx2UpdateCRC(0, command, pos);
+  command[pos++] = crc & 0xFF;         // crc low byte
+  command[pos++] = (crc >> 8) & 0xFF;  // crc high byte
+  *size = pos;
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// No action. Used to obtain a Dynamixel Status Packet.
+void dx2GetPingCommand(DX_UINT8 *command,    // buffer to put the resulting command string
+                       DX_UINT16 *size,      // length of the resulting command string
+                       DX_UINT8  id)         // Servo which should be adressed
+{
+  dx2GetCommand(command,size,id,DX2_PING,0,0);
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Read the values in the Control table.
+void dx2GetReadCommand(DX_UINT8 *command,         // buffer to put the resulting command string
+                       DX_UINT16 *size,           // length of the resulting command string
+                       DX_UINT8  id,              // Servo which should be adressed
+                       DX_UINT16 startingAdress,  // starting adress of read
+                       DX_UINT16 dataLength)      // length of data to read
+{
+  DX_UINT8 params[4];
+  params[0] = startingAdress & 0xFF;
+  params[1] = (startingAdress >> 8) & 0xFF;
+  params[2] = dataLength & 0xFF;
+  params[3] = (dataLength >> 8) & 0xFF;
+  dx2GetCommand(command,size,id,DX2_READ,params,4);
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Write the values to the Control Table.
+void dx2GetWriteCommand(DX_UINT8 *command,         // buffer to put the resulting command string
+                        DX_UINT16 *size,           // length of the resulting command string
+                        DX_UINT8  id,              // Servo which should be adressed
+                        DX_UINT16 startingAdress,  // starting adress of write
+                        const DX_UINT8 *data,      // data to write
+                        DX_UINT16 dataSize)        // length of data to write
+{
+  // the address is written in front of the data, both are stuffed while copying
+  command[0] = 0xFF;                   // start of packet
+  command[1] = 0xFF;                   // start of packet
+  command[2] = 0xFD;                   // start of packet
+  command[3] = 0x00;                   // reserved
+  command[4] = id;                     // id of recipient
+  command[7] = DX2_WRITE;              // instruction
+  DX_UINT8 address[2];
+  address[0] = startingAdress & 0xFF;         // parameter 1
+  address[1] = (startingAdress >> 8) & 0xFF;  // parameter 2
+  DX_UINT8 ffCount = 0;
+  DX_UINT16 pos = dx2CopyStuffed(command, 8, address, 2, &ffCount);
+  pos = dx2CopyStuffed(command, pos, data, dataSize, &ffCount);  // parameter 3..
+  DX_UINT16 length = pos - 8 + 3;      // length of packet (instruction + parameters + crc)
+  command[5] = length & 0xFF;
+  command[6] = (length >> 8) & 0xFF;
+  DX_UINT16 crc = dx2UpdateCRC(0, command, pos);
+  command[pos++] = crc & 0xFF;         // crc low byte
+  command[pos++] = (crc >> 8) & 0xFF;  // crc high byte
+  *size = pos;
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Read the same area of the Control Table of several servos.
+void dx2GetSyncReadCommand(DX_UINT8 *command,         // buffer to put the resulting command string
+                           DX_UINT16 *size,           // length of the resulting command string
+                           DX_UINT16 startingAdress,  // starting adress of read
+                           DX_UINT16 dataLength,      // length of data to read per servo
+                           const DX_UINT8 *ids,       // Servos which should be adressed
+                           DX_UINT8  count)           // number of servos
+{
+  DX_UINT8 params[4 + 255];
+  params[0] = startingAdress & 0xFF;
+  params[1] = (startingAdress >> 8) & 0xFF;
+  params[2] = dataLength & 0xFF;
+  params[3] = (dataLength >> 8) & 0xFF;
+  DX_UINT8 i;
+  for (i = 0; i < count; i++)
+    params[4+i] = ids[i];              // id of servo i
+  dx2GetCommand(command,size,DX_BROADCAST,DX2_SYNC_READ,params,4+count);
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Like SYNC_READ, but all servos answer within one concatenated status packet.
+void dx2GetFastSyncReadCommand(DX_UINT8 *command,         // buffer to put the resulting command string
+                               DX_UINT16 *size,           // length of the resulting command string
+                               DX_UINT16 startingAdress,  // starting adress of read
+                               DX_UINT16 dataLength,      // length of data to read per servo
+                               const DX_UINT8 *ids,       // Servos which should be adressed
+                               DX_UINT8  count)           // number of servos
+{
+  dx2GetSyncReadCommand(command,size,startingAdress,dataLength,ids,count);
+  // same layout, only the instruction and therefore the crc differ
+  command[7] = DX2_FAST_SYNC_READ;
+  DX_UINT16 crc = dx2UpdateCRC(0, command, *size - 2);
+  command[*size-2] = crc & 0xFF;       // crc low byte
+  command[*size-1] = (crc >> 8) & 0xFF;// crc high byte
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// returns the length of the packet at the start of the buffer
+int dx2GetStatusLength(const DX_UINT8 *status,    // buffer containing the status packet
+                       int size)                  // number of bytes in the buffer
+{
+  if (size < DX2_HEADER_SIZE)
+    return 0; // packet seems to be incomplete
+
+  // check for valid packet
+  if (status[0] != 0xFF || status[1] != 0xFF || status[2] != 0xFD || status[3] != 0x00)
+    return 0;
+
+  int length = DX2_HEADER_SIZE + (status[5] | (status[6] << 8));
+  if (length < DX2_MIN_PACKET_SIZE)
+    return -DX2_HEADER_SIZE; // corrupt length, drop the header
+  if (length > size)
+    return 0; // packet seems to be incomplete
+
+  DX_UINT16 crc = dx2UpdateCRC(0, status, length - 2);
+  if ((crc & 0xFF) != status[length-2] || ((crc >> 8) & 0xFF) != status[length-1])
+    return -length; // return negative length if packet has invalid crc
+  return length;
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// returns true if the crc is ok
+DX_BOOL dx2IsStatusValid(const DX_UINT8 *status, int size) // buffer containing the status packet
+{
+  return dx2GetStatusLength(status, size) > 0;
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// returns the sender id
+DX_UINT8 dx2GetStatusID(const DX_UINT8 *status)         // buffer containing the status packet
+{
+  return status[4];
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// returns the error byte (s. defines)
+DX_UINT8 dx2GetStatusErrorFlags(const DX_UINT8 *status) // buffer containing the status packet
+{
+  return status[8];
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// returns the number of parameters of the status packet (without the error byte)
+DX_UINT16 dx2GetStatusParameterCount(const DX_UINT8 *status) // buffer containing the status packet
+{
+  // instruction, error and crc are part of the length
+  DX_UINT16 length = status[5] | (status[6] << 8);
+  return length < 4 ? 0 : length - 4;
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// returns a pointer to the first parameter of the status packet
+const DX_UINT8 *dx2GetStatusParameters(const DX_UINT8 *status) // buffer containing the status packet
+{
+  return status + 9;
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Removes the byte stuffing of a received packet in place and updates its length field.
+int dx2RemoveStuffing(DX_UINT8 *status)          // buffer containing the status packet
+{
+  DX_UINT16 length = status[5] | (status[6] << 8);
+  DX_UINT16 end = DX2_HEADER_SIZE + length - 2; // crc is not stuffed
+  DX_UINT16 read = 8;
+  DX_UINT16 write = 8;
+  while (read < end)
+  {
+    status[write++] = status[read++];
+    // skip the 0xFD which has been added after 0xFF 0xFF 0xFD
+    if (read < end && status[read] == 0xFD && status[write-1] == 0xFD &&
+        status[write-2] == 0xFF && status[write-3] == 0xFF)
+      read++;
+  }
+  status[write++] = status[read++];    // crc low byte
+  status[write++] = status[read++];    // crc high byte
+  length = write - DX2_HEADER_SIZE;
+  status[5] = length & 0xFF;
+  status[6] = (length >> 8) & 0xFF;
+  return write;
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Copies one byte from read to write, skips a following stuffing byte and adds the received
+// (stuffed) bytes to crc.
+static void dx2CopyUnstuffed(DX_UINT8 *status, DX_UINT16 *read, DX_UINT16 *write, DX_UINT16 end,
+                             DX_UINT16 *crc)
+{
+  *crc = dx2UpdateCRC(*crc, status + *read, 1);
+  status[(*write)++] = status[(*read)++];
+  if (*read < end && status[*read] == 0xFD && status[*write-1] == 0xFD &&
+      status[*write-2] == 0xFF && status[*write-3] == 0xFF)
+  {
+    *crc = dx2UpdateCRC(*crc, status + *read, 1);
+    (*read)++;
+  }
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// Removes the byte stuffing of a FAST_SYNC_READ status packet in place and checks the crc of
+// every block within the same pass.
+int dx2RemoveFastSyncReadStuffing(DX_UINT8 *status,      // buffer containing the status packet
+                                  DX_UINT16 dataLength,  // length of data per servo
+                                  DX_BOOL *valid,        // crc result per block
+                                  int maxBlocks)         // size of valid
+{
+  DX_UINT16 length = status[5] | (status[6] << 8);
+  DX_UINT16 end = DX2_HEADER_SIZE + length - 2; // crc of the packet is not stuffed
+  DX_UINT16 read = 8;
+  DX_UINT16 write = 8;
+  DX_UINT16 crc = dx2UpdateCRC(0, status, 8);
+  int blocks = 0;
+  while (read < end && blocks < maxBlocks)
+  {
+    // error, id and data
+    DX_UINT16 blockEnd = write + dataLength + 2;
+    while (read < end && write < blockEnd)
+      dx2CopyUnstuffed(status, &read, &write, end, &crc);
+    if (write < blockEnd)
+      break;
+    DX_UINT16 blockCRC = crc;
+    DX_UINT16 received;
+    if (read == end)
+    {
+      // the crc of the last block is the crc of the packet
+      received = status[end] | (status[end+1] << 8);
+    }
+    else
+    {
+      DX_UINT16 crcStart = write;
+      while (read < end && write < crcStart + 2)
+        dx2CopyUnstuffed(status, &read, &write, end, &crc);
+      if (write < crcStart + 2)
+        break;
+      received = status[crcStart] | (status[crcStart+1] << 8);
+    }
+    valid[blocks++] = received == blockCRC;
+  }
+  while (read < end)
+    dx2CopyUnstuffed(status, &read, &write, end, &crc);
+  status[write++] = status[read++];    // crc low byte
+  status[write++] = status[read++];    // crc high byte
+  length = write - DX2_HEADER_SIZE;
+  status[5] = length & 0xFF;
+  status[6] = (length >> 8) & 0xFF;
+  return blocks;
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// returns the number of servo blocks in an (unstuffed) FAST_SYNC_READ status packet
+DX_UINT16 dx2GetFastSyncReadBlockCount(const DX_UINT8 *status,  // buffer containing the status packet
+                                       DX_UINT16 dataLength)    // length of data per servo
+{
+  // the blocks start at the error byte, every block but the last one is followed
+  // by two crc bytes, the last one by the crc of the packet
+  DX_UINT16 length = DX2_HEADER_SIZE + (status[5] | (status[6] << 8));
+  return (length - 8) / (dataLength + 4);
+}
+
+
+
+//------------------------------------------------------------------------------------------------------
+// returns a pointer to block index of an (unstuffed) FAST_SYNC_READ status packet.
+const DX_UINT8 *dx2GetFastSyncReadBlock(const DX_UINT8 *status,  // buffer containing the status packet
+                                        DX_UINT16 dataLength,    // length of data per servo
+                                        DX_UINT16 index)         // index of the block
+{
+  return status + 8 + index * (dataLength + 4);
+}
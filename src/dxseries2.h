@@ -0,0 +1,180 @@
+#ifndef DXSERIES2_H
+#define DXSERIES2_H
+/*
+ *  Robotis Dynamixel Protocol 2.0 Control Library
+ *
+ *  The library generates the appropriate Protocol 2.0 command strings
+ *  (used by the X series) which then should be sent by the accordant
+ *  usart commands of the actually used system, and parses the received
+ *  status packets. Types and the broadcast id are shared with dxseries.h.
+ *
+ *  Packet layout:
+ *    0xFF 0xFF 0xFD 0x00 ID LEN_L LEN_H INSTRUCTION PARAMETERS... CRC_L CRC_H
+ *  LEN counts the bytes from INSTRUCTION up to and including the CRC.
+ *  A status packet uses the instruction 0x55 followed by an error byte.
+ *
+ */
+
+#include "dxseries.h"
+
+//------------------------------------------------------------------------------------------------------
+// some defines
+
+// types
+#define DX_INT16  short
+#define DX_INT32  int
+
+// available commands
+#define DX2_PING          0x01
+#define DX2_READ          0x02
+#define DX2_WRITE         0x03
+#define DX2_REGWRITE      0x04
+#define DX2_ACTION        0x05
+#define DX2_FACTORY_RESET 0x06
+#define DX2_REBOOT        0x08
+#define DX2_STATUS        0x55
+#define DX2_SYNC_READ     0x82
+#define DX2_FAST_SYNC_READ 0x8A
+
+// error byte of the status packet, bit 7 is the hardware alert flag,
+// bits 0..6 contain one of the error numbers below
+#define DX2_ALERT              0x80
+#define DX2_ERROR_NUMBER_MASK  0x7F
+#define DX2_RESULT_FAIL        0x01
+#define DX2_INSTRUCTION_ERROR  0x02
+#define DX2_CRC_ERROR          0x03
+#define DX2_DATA_RANGE_ERROR   0x04
+#define DX2_DATA_LENGTH_ERROR  0x05
+#define DX2_DATA_LIMIT_ERROR   0x06
+#define DX2_ACCESS_ERROR       0x07
+
+// X series memory
+#define DX2_PRESENT_CURRENT    126
+#define DX2_PRESENT_VELOCITY   128
+#define DX2_PRESENT_POSITION   132
+#define DX2_PRESENT_VALUES_SIZE 10
+
+// 0xFF 0xFF 0xFD 0x00 ID LEN_L LEN_H
+#define DX2_HEADER_SIZE        7
+// header, instruction and crc
+#define DX2_MIN_PACKET_SIZE   10
+// header, instruction, error and crc
+#define DX2_MIN_STATUS_SIZE   11
+
+
+//------------------------------------------------------------------------------------------------------
+// some structs
+
+typedef struct Dx2PresentValues_type {
+  DX_INT16  presentCurrent;              //-- Current consumption of the Dynamixel, unit depends on the model
+                                         //   (2.69mA per step on the XM series).
+  DX_INT32  presentVelocity;             //-- Current velocity of the Dynamixel, 0.229rpm per step.
+  DX_INT32  presentPosition;             //-- Current position of the Dynamixel, 4096 steps per revolution.
+} Dx2PresentValues;
+
+
+//------------------------------------------------------------------------------------------------------
+// basic library functions
+
+// Updates the CRC-16 (polynomial 0x8005) with size bytes of data, start with crc = 0.
+DX_UINT16 dx2UpdateCRC(DX_UINT16 crc,            // crc of the preceding data
+                       const DX_UINT8 *data,     // data to add
+                       DX_UINT16 size);          // number of bytes
+
+// Builds an instruction packet, the parameters are byte stuffed.
+// The buffer has to provide 10 + paramCount + paramCount / 3 bytes.
+void dx2GetCommand(DX_UINT8 *command,           // buffer to put the resulting command string
+                   DX_UINT16 *size,             // length of the resulting command string
+                   DX_UINT8  id,                // Servo which should be adressed
+                   DX_UINT8  instruction,       // instruction, see defines above
+                   const DX_UINT8 *params,      // parameters of the instruction
+                   DX_UINT16 paramCount);       // number of parameters
+
+// No action. Used to obtain a Dynamixel Status Packet.
+void dx2GetPingCommand(DX_UINT8 *command,    // buffer to put the resulting command string
+                       DX_UINT16 *size,      // length of the resulting command string
+                       DX_UINT8  id);        // Servo which should be adressed
+
+// Read the values in the Control table.
+void dx2GetReadCommand(DX_UINT8 *command,         // buffer to put the resulting command string
+                       DX_UINT16 *size,           // length of the resulting command string
+                       DX_UINT8  id,              // Servo which should be adressed
+                       DX_UINT16 startingAdress,  // starting adress of read
+                       DX_UINT16 dataLength);     // length of data to read
+
+// Write the values to the Control Table.
+void dx2GetWriteCommand(DX_UINT8 *command,         // buffer to put the resulting command string
+                        DX_UINT16 *size,           // length of the resulting command string
+                        DX_UINT8  id,              // Servo which should be adressed
+                        DX_UINT16 startingAdress,  // starting adress of write
+                        const DX_UINT8 *data,      // data to write
+                        DX_UINT16 dataSize);       // length of data to write
+
+// Read the same area of the Control Table of several servos. Every servo answers with
+// its own status packet, in the order of ids.
+void dx2GetSyncReadCommand(DX_UINT8 *command,         // buffer to put the resulting command string
+                           DX_UINT16 *size,           // length of the resulting command string
+                           DX_UINT16 startingAdress,  // starting adress of read
+                           DX_UINT16 dataLength,      // length of data to read per servo
+                           const DX_UINT8 *ids,       // Servos which should be adressed
+                           DX_UINT8  count);          // number of servos
+
+// Like SYNC_READ, but all servos answer within one concatenated status packet,
+// see dx2GetFastSyncReadBlock().
+void dx2GetFastSyncReadCommand(DX_UINT8 *command,         // buffer to put the resulting command string
+                               DX_UINT16 *size,           // length of the resulting command string
+                               DX_UINT16 startingAdress,  // starting adress of read
+                               DX_UINT16 dataLength,      // length of data to read per servo
+                               const DX_UINT8 *ids,       // Servos which should be adressed
+                               DX_UINT8  count);          // number of servos
+
+
+//------------------------------------------------------------------------------------------------------
+// status packet parsing
+
+// returns the length of the packet at the start of the buffer, 0 if the packet is
+// incomplete or does not start with a header, the negative length if the crc is invalid
+int dx2GetStatusLength(const DX_UINT8 *status,    // buffer containing the status packet
+                       int size);                 // number of bytes in the buffer
+
+// returns true if the crc is ok
+DX_BOOL dx2IsStatusValid(const DX_UINT8 *status, int size); // buffer containing the status packet
+
+// returns the sender id
+DX_UINT8 dx2GetStatusID(const DX_UINT8 *status);         // buffer containing the status packet
+
+// returns the error byte (s. defines)
+DX_UINT8 dx2GetStatusErrorFlags(const DX_UINT8 *status); // buffer containing the status packet
+
+// returns the number of parameters of the status packet (without the error byte)
+DX_UINT16 dx2GetStatusParameterCount(const DX_UINT8 *status); // buffer containing the status packet
+
+// returns a pointer to the first parameter of the status packet
+const DX_UINT8 *dx2GetStatusParameters(const DX_UINT8 *status); // buffer containing the status packet
+
+// Removes the byte stuffing of a received packet in place and updates its length field.
+// Has to be called after the crc has been checked, since the crc covers the stuffed packet.
+// returns the new length of the packet
+int dx2RemoveStuffing(DX_UINT8 *status);         // buffer containing the status packet
+
+// Removes the byte stuffing of a FAST_SYNC_READ status packet in place like dx2RemoveStuffing()
+// and checks the crc following every block within the same pass. Every servo appends the crc of
+// the received packet up to the end of its block, the crc of the last block is the crc of the
+// packet. Has to be called after the crc of the packet has been checked.
+// returns the number of blocks whose result has been stored to valid
+int dx2RemoveFastSyncReadStuffing(DX_UINT8 *status,      // buffer containing the status packet
+                                  DX_UINT16 dataLength,  // length of data per servo
+                                  DX_BOOL *valid,        // crc result per block
+                                  int maxBlocks);        // size of valid
+
+// returns the number of servo blocks in an (unstuffed) FAST_SYNC_READ status packet
+DX_UINT16 dx2GetFastSyncReadBlockCount(const DX_UINT8 *status,  // buffer containing the status packet
+                                       DX_UINT16 dataLength);   // length of data per servo
+
+// returns a pointer to block index of an (unstuffed) FAST_SYNC_READ status packet.
+// A block consists of the error byte, the id and dataLength bytes of data.
+const DX_UINT8 *dx2GetFastSyncReadBlock(const DX_UINT8 *status,  // buffer containing the status packet
+                                        DX_UINT16 dataLength,    // length of data per servo
+                                        DX_UINT16 index);        // index of the block
+
+#endif
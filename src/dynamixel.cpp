@@ -2,19 +2,33 @@
 
 #include "dynamixel.h"
 
+#include <unistd.h>
+
 #include <iostream>
 #include <sstream>
 
+#include <base/Time.hpp>
 #include <base-logging/Logging.hpp>
 
 /////////////////////////////// PUBLIC ///////////////////////////////////////
+
 Dynamixel::Dynamixel()
 {
     mActiveServoID = 0;
     mpActiveServo = NULL;
-    mNumberRetries = 0;
+    mPipelineDepth = 4;
+    mWriteCache = false;
+    mReadGapTolerance = 8;
+    mQuarantineThreshold = 3;
+    mProbeInterval = base::Time::fromMilliseconds(500);
+    mBatchSize = 0;
+    mBatchOpen = false;
+    mLastStatusSize = 0;
     mpDynamixelIODriver = new DynamixelIODriver();
-    buildControlTable();
+    for(int i=0; i<cServoTableSize; i++)
+    {
+        mServoTable[i] = NULL;
+    }
 }
 
 Dynamixel::~Dynamixel()
@@ -32,15 +46,15 @@ Dynamixel::~Dynamixel()
 bool Dynamixel::addServo(DX_UINT8 id_)
 {
     //id already added?
-    for(unsigned int i=0; i<mServoList.size(); i++)
+    if(findServo(id_) != NULL)
     {
-        if(mServoList[i]->mID == id_)
-        {
-            LOG_WARN("Servo ID %d already added", (int)id_);
-            return false;
-        }
+        LOG_WARN("Servo ID %d already added", (int)id_);
+        return false;
     }
-    mServoList.push_back(new Servo(id_));
+    Servo* servo = new Servo(id_);
+    servo->mIndex = mState.add(id_);
+    mServoList.push_back(servo);
+    mServoTable[id_] = servo;
     LOG_INFO("Servo ID %d added", (int)id_);
 
     if(mServoList.size() == 1) {
@@ -51,64 +65,105 @@ bool Dynamixel::addServo(DX_UINT8 id_)
 
 bool Dynamixel::getControlTableEntry(std::string const item_name, uint16_t * const value_)
 {
-    if(mpActiveServo == NULL)
+    return checkActiveServo() && getControlTableEntry(mActiveServoID, item_name, value_);
+}
+
+bool Dynamixel::getControlTableEntry(DX_UINT8 const id_, std::string const item_name, uint16_t * const value_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
     {
-        LOG_WARN("No active servo available, use setServoActive() first");
+        LOG_WARN("Servo ID %d is not available", (int)id_);
         return false;
     }
+    ControlTableEntry const* entry_ = servo->mControlTable->findByName(item_name);
+    if(entry_ == NULL)
+    {
+        LOG_WARN("Control table entry name %s is unknown", item_name.c_str());
+        return false;
+    }
+    return readEntry(id_, entry_->mNumber, entry_->mAddress, entry_->mBytes, value_);
+}
 
-     struct ControlTableEntry* entry_ = mMapStringCTEntry[item_name];
-     if(entry_ == NULL)
-     {
-         LOG_WARN("Control table entry name %s is unknown", item_name.c_str());
-         return false;
-     }
-
-     DX_UINT8 command_length_bytes;
-     dxGetReadCommand(mCommandBuffer,
-         &command_length_bytes,
-         mActiveServoID,
-         entry_->mAddress,
-         entry_->mBytes);
-     if(writeCommandReadAnswer(command_length_bytes, mpActiveServo->status))
-     {
-        uint16_t value_temp = mBuffer[5];
-        if(entry_->mBytes == 2)
+bool Dynamixel::flush()
+{
+    bool ok = true;
+    for(unsigned int s=0; s<mServoList.size(); s++)
+    {
+        Servo* servo = mServoList[s];
+        ControlTable const& table = *servo->mControlTable;
+        int i = 0;
+        while(i < table.size())
         {
-            int byte_high = mBuffer[6];
-            value_temp = (value_temp | (byte_high << 8));
+            if(!servo->mDirty[table[i].mNumber])
+            {
+                ++i;
+                continue;
+            }
+            // collect the run of dirty entries without gaps in between
+            DX_UINT8 data[cCommandBufferSize];
+            int length = 0;
+            int first = i;
+            do
+            {
+                length += dx::putLittleEndian(data + length, servo->mControlTableValues[table[i].mNumber], table[i].mBytes);
+                ++i;
+            } while(i < table.size() && servo->mDirty[table[i].mNumber] &&
+                    table[i].mAddress == table[first].mAddress + length);
+
+            DX_UINT8 command_length_bytes;
+            dxGetWriteCommand(mCommandBuffer, &command_length_bytes, servo->mID,
+                    table[first].mAddress, data, length);
+            if(writeCommandReadAnswer(command_length_bytes, servo))
+            {
+                for(int j=first; j<i; j++)
+                {
+                    int number = table[j].mNumber;
+                    storeWrittenValue(servo, number, servo->mControlTableValues[number]);
+                }
+                LOG_DEBUG("Servo %d: %d bytes flushed starting at address %d", (int)servo->mID,
+                        length, table[first].mAddress);
+            }
+            else
+            {
+                LOG_ERROR("Servo %d: dirty values at address %d could not be written", (int)servo->mID,
+                        table[first].mAddress);
+                ok = false;
+            }
         }
-        *value_ = value_temp;
-        //update the control table entry of the servo with the ID id_,
-        //the array position is listed in the entry object
-        mpActiveServo->mControlTableValues[entry_->mNumber] = value_temp;
-        LOG_INFO("Control table entry %s has been changed to %d", item_name.c_str(), value_temp);
-        return true;
-     }
-     return false;
+    }
+    return ok;
 }
 
 std::string Dynamixel::getControlTableString()
 {
-    if(mpActiveServo == NULL)
+    return checkActiveServo() ? getControlTableString(mActiveServoID) : "";
+}
+
+std::string Dynamixel::getControlTableString(DX_UINT8 const id_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
     {
-        LOG_WARN("No active servo available, use setServoActive() first");
+        LOG_WARN("Servo ID %d is not available", (int)id_);
         return "";
     }
+    ControlTable const& table = *servo->mControlTable;
     std::stringstream stream;
     const int NAME_LENGTH = 30;
-    for(int i=0; i<cControlTableEntriesNumber; i++)
+    for(int i=0; i<table.size(); i++)
     {
-        if (i<10)
+        int number = table[i].mNumber;
+        if (number<10)
 			stream << " ";
-        stream << i;
-        stream << "  " << mControlTableEntries[i].mName;
+        stream << number;
+        stream << "  " << table[i].mName;
         //every name string should have a length of NAME_LENGTH
-        for(int j=(int)mControlTableEntries[i].mName.length(); j<NAME_LENGTH; j++)
+        for(int j=(int)table[i].mName.length(); j<NAME_LENGTH; j++)
         {
             stream << ' ';
         }
-        stream << mpActiveServo->mControlTableValues[i] << '\n';
+        stream << servo->mControlTableValues[number] << '\n';
     }
     std::string s;
     s = stream.str();
@@ -117,308 +172,1623 @@ std::string Dynamixel::getControlTableString()
 
 bool Dynamixel::getPresentPosition(uint16_t * const pos_)
 {
-    if(mpActiveServo == NULL)
+    return checkActiveServo() && getPresentPosition(mActiveServoID, pos_);
+}
+
+bool Dynamixel::getPresentPosition(DX_UINT8 const id_, uint16_t * const pos_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
     {
-        LOG_WARN("No active servo available, use setServoActive() first");
+        LOG_WARN("Servo ID %d is not available", (int)id_);
         return false;
     }
 
     DX_UINT8 command_length_bytes;
-    dxGetReadCommand(mCommandBuffer, &command_length_bytes, mActiveServoID, 36, 2);
-    if(writeCommandReadAnswer(command_length_bytes, mpActiveServo->status ))
+    dxGetReadCommand(mCommandBuffer, &command_length_bytes, id_,
+            dx::PresentPosition::address, dx::PresentPosition::bytes);
+    if(writeCommandReadAnswer(command_length_bytes, servo))
     {
-        int byte_low = mBuffer[5];
-        int byte_high = mBuffer[6];
-        *pos_ = (byte_low | (byte_high << 8));
-        mpActiveServo->mControlTableValues[25] = *pos_;
+        *pos_ = StatusPacket(mBuffer, cBufferSize).get<dx::PresentPosition>(dx::PresentPosition::address);
+        storeReadValue(servo, dx::PresentPosition::number, *pos_);
         LOG_DEBUG("Current position is %d (steps)", *pos_);
         return true;
     }
     return false;
 }
 
-bool Dynamixel::init(std::string const & uri)
-{
-    return mpDynamixelIODriver->open(uri);
-}
-
-bool Dynamixel::readControlTable()
+bool Dynamixel::readPresentValues(DX_UINT8 const id_, DxPresentValues& values_)
 {
-    if(mpActiveServo == NULL)
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
     {
-        LOG_WARN("No active servo available, use setServoActive() first");
+        LOG_WARN("Servo ID %d is not available", (int)id_);
         return false;
     }
 
+    // Present Position up to Present Temperature
+    int const address = dx::PresentPosition::address;
     DX_UINT8 command_length_bytes;
-    dxGetReadCompleteCommand(mCommandBuffer, &command_length_bytes, mActiveServoID);
-    if( (writeCommandReadAnswer(command_length_bytes, mpActiveServo->status)) && (mActiveServoID != DX_BROADCAST) ) //fills the mBuffer, if talking to one specific servo
+    dxGetReadCommand(mCommandBuffer, &command_length_bytes, id_, address,
+            dx::PresentTemperature::address + dx::PresentTemperature::bytes - address);
+    if(!writeCommandReadAnswer(command_length_bytes, servo))
     {
-        struct DxComplete_type mCompleteControlTable;
-        dxGetComplete(mBuffer, &mCompleteControlTable);
-        //fill the control table items
-        DX_UINT8* p_ct = (DX_UINT8*)&mCompleteControlTable;
-        for(int i=0; i<cControlTableEntriesNumber; i++)
-        {
-            mpActiveServo->mControlTableValues[i] = *p_ct;
-            ++p_ct;
-            //build value if it consists of two bytes
-            if(mControlTableEntries[i].mBytes == 2)
-            {
-                mpActiveServo->mControlTableValues[i] = (mpActiveServo->mControlTableValues[i] | (*p_ct << 8));
-                ++p_ct;
-            }
-        }
-        LOG_DEBUG("All controls have been read")
-        return true;
+        LOG_ERROR("Present values of servo %d could not be read", (int)id_);
+        return false;
     }
-    LOG_ERROR("Controls could not be read");
-    return false;
+
+    StatusPacket status(mBuffer, cBufferSize);
+    values_.presentPosition = status.get<dx::PresentPosition>(address);
+    values_.presentSpeed = status.get<dx::PresentSpeed>(address);
+    values_.presentLoad = status.get<dx::PresentLoad>(address);
+    values_.presentVoltage = status.get<dx::PresentVoltage>(address);
+    values_.presentTemperature = status.get<dx::PresentTemperature>(address);
+    setControlTableValues(servo, status, address);
+    return true;
 }
 
-bool Dynamixel::setControlTableEntry(std::string item_name, uint16_t const value_)
+servo_dynamixel::ModelInfo const* Dynamixel::getModel(DX_UINT8 const id_)
 {
-    if(mpActiveServo == NULL)
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
     {
-        LOG_WARN("No active servo available, use setServoActive() first");
-        return "";
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        return NULL;
     }
-
-    struct ControlTableEntry* entry = mMapStringCTEntry[item_name];
-    if(entry == NULL)
+    if(servo->mModel != NULL)
     {
-        LOG_WARN("Control table entry name %s is unknown", item_name.c_str());
-        return false;
+        return servo->mModel;
     }
 
-    DX_UINT8 command_length_bytes;
-    dxGetWriteCommand(mCommandBuffer,
-        &command_length_bytes,
-        mActiveServoID,
-        entry->mAddress,
-        (DX_UINT8*)&value_,
-        entry->mBytes);
-    if(writeCommandReadAnswer(command_length_bytes, mpActiveServo->status ))
+    uint16_t model_number = 0;
+    if(!get<dx::ModelNumber>(id_, &model_number))
     {
-        mpActiveServo->mControlTableValues[entry->mNumber] = value_;
-        LOG_INFO("Control table entry %s has been set to %hu", item_name.c_str(), value_);
-
-        return isErrorStatusOk();
+        return NULL;
     }
-    LOG_ERROR("Control table entry %s could not be changed to %hu", item_name.c_str(), value_);
-    return false;
-}
-
-servo_dynamixel::ErrorStatus Dynamixel::getErrorStatus()
-{
-    return mpActiveServo->status;
+    servo->mModel = servo_dynamixel::findModel(model_number);
+    servo->mControlTable = &ControlTable::get(model_number);
+    if(servo->mModel == NULL)
+    {
+        LOG_WARN("Servo ID %d has the unknown model number %d", (int)id_, (int)model_number);
+    }
+    return servo->mModel;
 }
 
-bool Dynamixel::isErrorStatusOk()
+bool Dynamixel::bulkReadPresent()
 {
-    if(mpActiveServo == NULL)
+    DX_UINT8 ids[cCommandBufferSize];
+    DX_UINT8 addresses[cCommandBufferSize];
+    DX_UINT8 lengths[cCommandBufferSize];
+    DX_UINT8 count = 0;
+    // Present Position up to Present Temperature
+    int const address = dx::PresentPosition::address;
+    int const length = dx::PresentTemperature::address + dx::PresentTemperature::bytes - address;
+    for(unsigned int i=0; i<mServoList.size(); i++)
+    {
+        if(mServoList[i]->mID == DX_BROADCAST || !isAvailable(mServoList[i]))
+        {
+            continue;
+        }
+        ids[count] = mServoList[i]->mID;
+        addresses[count] = address;
+        lengths[count] = length;
+        ++count;
+    }
+    if(count == 0 || 3 * count + 7 > cCommandBufferSize)
     {
-        LOG_ERROR("No active servo available, use setServoActive() first");
+        LOG_WARN("Bulk read of %d servos is not possible", (int)count);
         return false;
     }
 
-    if( mpActiveServo->status.hasError() )
+    DX_UINT8 command_length_bytes;
+    dxGetBulkReadCommand(mCommandBuffer, &command_length_bytes, ids, addresses, lengths, count);
+    for(int i=0; i<count; i++)
     {
-        LOG_ERROR("Dynamixel error status is not ok");
-	return false;
+        mpDynamixelIODriver->addExpectedAnswer(ids[i], lengths[i]);
+    }
+    if(!writeRequest(command_length_bytes))
+    {
+        mpDynamixelIODriver->clearExpectedAnswer();
+        LOG_ERROR("Bulk read could not be sent");
+        return false;
+    }
+    // the servos answer one after another, each after its Return Delay Time
+    base::Time return_delays;
+    for(int i=0; i<count; i++)
+    {
+        return_delays = return_delays + getReturnDelay(ids[i]);
+    }
+    base::Time deadline = base::Time::now() + mpDynamixelIODriver->getAnswerTimeout(command_length_bytes,
+            count * (6 + length), return_delays);
+
+    // the servos answer one after another, a missing servo stops the chain
+    int received = 0;
+    std::vector<DX_UINT8> answered;
+    try {
+        for(int i=0; i<count; i++)
+        {
+            int packet_size = readPacketUntil(deadline);
+            StatusPacket status(mBuffer, packet_size);
+            if(packet_size <= 0 || !status.isValid())
+            {
+                LOG_ERROR("Invalid status packet received during bulk read");
+                break;
+            }
+            Servo* servo = findServo(status.getID());
+            if(servo == NULL)
+            {
+                LOG_WARN("Status packet of unknown servo %d received", (int)status.getID());
+                continue;
+            }
+            updateErrorStatus(servo);
+            if(status.getParameterCount() == 0)
+            {
+                // rejected, the next servo answers nevertheless
+                LOG_ERROR("Servo %d rejected the bulk read (error 0x%x)", (int)servo->mID,
+                        status.getErrorFlags());
+                answered.push_back(servo->mID);
+                continue;
+            }
+            setControlTableValues(servo, status, address);
+            answered.push_back(servo->mID);
+            ++received;
+        }
+    } catch(iodrivers_base::UnixError& e) {
+        LOG_ERROR("UnixError catched: %s", e.what());
+    } catch(iodrivers_base::TimeoutError& e) {
+        LOG_ERROR("TimeoutError catched: %s", e.what());
     }
+    mpDynamixelIODriver->clearExpectedAnswer();
+    recordAnswers(ids, count, answered);
 
+    if(received != count)
+    {
+        LOG_ERROR("Bulk read: %d of %d servos answered", received, (int)count);
+        return false;
+    }
     return true;
 }
 
-bool Dynamixel::setGoalPosition(uint16_t const pos_)
+bool Dynamixel::syncReadPresent(bool const fast_)
 {
-    if(mpActiveServo == NULL)
+    if(mpDynamixelIODriver->getProtocol() != DynamixelIODriver::PROTOCOL_2)
     {
-        LOG_WARN("No active servo available, use setServoActive() first");
+        LOG_WARN("Sync read requires protocol 2.0, use setProtocol() first");
         return false;
     }
 
-    DX_UINT8 command_length_bytes;
-    dxGetWriteCommand(mCommandBuffer, &command_length_bytes, mActiveServoID, 30, (DX_UINT8*)&pos_, 2);
-    if(writeCommandReadAnswer(command_length_bytes, mpActiveServo->status))
+    DX_UINT8 ids[cCommandBufferSize];
+    DX_UINT8 count = 0;
+    for(unsigned int i=0; i<mServoList.size(); i++)
     {
-        mpActiveServo->mControlTableValues[22] = pos_;
-        LOG_DEBUG("Active servo %d set to %hu (steps)", mActiveServoID, pos_);
-
-        return isErrorStatusOk();
+        if(mServoList[i]->mID != DX_BROADCAST && isAvailable(mServoList[i]))
+        {
+            ids[count++] = mServoList[i]->mID;
+        }
+    }
+    // 14 bytes header, instruction, address, length and crc
+    if(count == 0 || count + 14 > cCommandBufferSize)
+    {
+        LOG_WARN("Sync read of %d servos is not possible", (int)count);
+        return false;
     }
-    LOG_ERROR("Active servo %d position could not be changed", mActiveServoID);
-    return false;
-}
 
-Dynamixel::Servo* Dynamixel::setServoActive(DX_UINT8 id_)
-{
-    for(unsigned int i=0; i<mServoList.size(); i++)
+    DX_UINT16 command_length_bytes;
+    if(fast_)
+    {
+        dx2GetFastSyncReadCommand(mCommandBuffer, &command_length_bytes,
+                DX2_PRESENT_CURRENT, DX2_PRESENT_VALUES_SIZE, ids, count);
+    }
+    else
+    {
+        dx2GetSyncReadCommand(mCommandBuffer, &command_length_bytes,
+                DX2_PRESENT_CURRENT, DX2_PRESENT_VALUES_SIZE, ids, count);
+    }
+    if(!writeRequest(command_length_bytes))
+    {
+        LOG_ERROR("Sync read could not be sent");
+        return false;
+    }
+    // a status packet per servo (11 bytes and the data), the fast sync read combines
+    // them into one packet with error, id, data and crc per servo
+    base::Time return_delays;
+    for(int i=0; i<count; i++)
     {
-        if(mServoList[i]->mID == id_)
+        return_delays = return_delays + getReturnDelay(ids[i]);
+    }
+    int answer_bytes = fast_ ? 10 + count * (DX2_PRESENT_VALUES_SIZE + 4) :
+            count * (11 + DX2_PRESENT_VALUES_SIZE);
+    base::Time deadline = base::Time::now() + mpDynamixelIODriver->getAnswerTimeout(command_length_bytes,
+            answer_bytes, return_delays);
+
+    int received = 0;
+    std::vector<DX_UINT8> answered;
+    try {
+        if(fast_)
+        {
+            int packet_size = readPacketUntil(deadline);
+            if(packet_size > 0 && dx2IsStatusValid(mBuffer, packet_size) &&
+                    dx2GetStatusID(mBuffer) == DX_BROADCAST)
+            {
+                DX_BOOL valid[cCommandBufferSize];
+                int blocks = dx2RemoveFastSyncReadStuffing(mBuffer, DX2_PRESENT_VALUES_SIZE, valid, count);
+                for(int i=0; i<blocks; i++)
+                {
+                    if(!valid[i])
+                    {
+                        // not even the id can be trusted
+                        LOG_WARN("Invalid crc of block %d reported during fast sync read", i);
+                        continue;
+                    }
+                    // error, id, data
+                    const DX_UINT8* block = dx2GetFastSyncReadBlock(mBuffer, DX2_PRESENT_VALUES_SIZE, i);
+                    Servo* servo = findServo(block[1]);
+                    if(servo == NULL)
+                    {
+                        continue;
+                    }
+                    updateErrorStatus2(servo, block[0]);
+                    setPresentValues2(servo, block + 2);
+                    answered.push_back(servo->mID);
+                    ++received;
+                }
+            }
+            else
+            {
+                LOG_ERROR("Invalid status packet received during fast sync read");
+            }
+        }
+        else
         {
-            mActiveServoID = id_;
-            mpActiveServo = mServoList[i];
-            LOG_INFO("Servo ID %d activated", id_);
-            return mServoList[i];
+            for(int i=0; i<count; i++)
+            {
+                int packet_size = readPacketUntil(deadline);
+                if(packet_size <= 0 || !dx2IsStatusValid(mBuffer, packet_size))
+                {
+                    LOG_ERROR("Invalid status packet received during sync read");
+                    break;
+                }
+                dx2RemoveStuffing(mBuffer);
+                Servo* servo = findServo(dx2GetStatusID(mBuffer));
+                if(servo != NULL && dx2GetStatusParameterCount(mBuffer) == 0 &&
+                        (dx2GetStatusErrorFlags(mBuffer) & DX2_ERROR_NUMBER_MASK) != 0)
+                {
+                    // rejected, the next servo answers nevertheless
+                    LOG_ERROR("Servo %d rejected the sync read (error 0x%x)", (int)servo->mID,
+                            dx2GetStatusErrorFlags(mBuffer));
+                    updateErrorStatus2(servo, dx2GetStatusErrorFlags(mBuffer));
+                    answered.push_back(servo->mID);
+                    continue;
+                }
+                if(servo == NULL || dx2GetStatusParameterCount(mBuffer) < DX2_PRESENT_VALUES_SIZE)
+                {
+                    LOG_WARN("Unexpected status packet of servo %d received", (int)dx2GetStatusID(mBuffer));
+                    continue;
+                }
+                updateErrorStatus2(servo, dx2GetStatusErrorFlags(mBuffer));
+                setPresentValues2(servo, dx2GetStatusParameters(mBuffer));
+                answered.push_back(servo->mID);
+                ++received;
+            }
         }
+    } catch(iodrivers_base::UnixError& e) {
+        LOG_ERROR("UnixError catched: %s", e.what());
+    } catch(iodrivers_base::TimeoutError& e) {
+        LOG_ERROR("TimeoutError catched: %s", e.what());
     }
-    LOG_WARN("Servo ID %d is not available and could not be activated", id_);
-    return NULL;
-}
+    recordAnswers(ids, count, answered);
 
-bool Dynamixel::getControlTableEntry(std::string const name, struct ControlTableEntry& entry) {
-    std::map<std::string, struct ControlTableEntry*>::iterator it;
-    it = mMapStringCTEntry.find(name);
-    if(it != mMapStringCTEntry.end()) {
-        entry = *(it->second);
-        return true;
+    if(received != count)
+    {
+        LOG_ERROR("Sync read: %d of %d servos answered", received, (int)count);
+        return false;
     }
-    LOG_WARN("Control table entry %s is unknown", name.c_str());
-    return false;
+    return true;
 }
 
-std::vector<Dynamixel::Servo> Dynamixel::getServoListCopy() {
-    std::vector<struct Servo> servo_list_copy;
-    for(unsigned int i=0; i < mServoList.size(); ++i) {
-        servo_list_copy.push_back(*(mServoList.at(i)));
+bool Dynamixel::readPipelined(std::vector<ReadRequest>& requests_)
+{
+    // a read instruction packet has 8 bytes
+    unsigned int const max_depth = cCommandBufferSize / 8;
+    unsigned int depth = mPipelineDepth < max_depth ? mPipelineDepth : max_depth;
+    if(depth == 0)
+    {
+        depth = 1;
     }
-    return servo_list_copy;
-}
 
-/////////////////////////////// PRIVATE //////////////////////////////////////
-void Dynamixel::buildControlTable()
-{
-    mControlTableEntries[ 0] = ControlTableEntry( 0, "Model Number", 2, 0);
-    mControlTableEntries[ 1] = ControlTableEntry( 2, "Version of Firmware", 1, 1);
-    mControlTableEntries[ 2] = ControlTableEntry( 3, "ID", 1, 2);
-    mControlTableEntries[ 3] = ControlTableEntry( 4, "Baud Rate", 1, 3);
-    mControlTableEntries[ 4] = ControlTableEntry( 5, "Return Delay Time", 1, 4);
-    mControlTableEntries[ 5] = ControlTableEntry( 6, "CW Angle Limit", 2, 5);
-    mControlTableEntries[ 6] = ControlTableEntry( 8, "CCW Angle Limit", 2, 6);
-    mControlTableEntries[ 7] = ControlTableEntry(11, "the Highest Limit Temperature", 1, 7);
-    mControlTableEntries[ 8] = ControlTableEntry(12, "the Lowest Limit Voltage", 1, 8);
-    mControlTableEntries[ 9] = ControlTableEntry(13, "the Highest Limit Voltage", 1, 9);
-    mControlTableEntries[10] = ControlTableEntry(14, "Max Torque", 2, 10);
-    mControlTableEntries[11] = ControlTableEntry(16, "Status Return Level", 1, 11);
-    mControlTableEntries[12] = ControlTableEntry(17, "Alarm LED", 1, 12);
-    mControlTableEntries[13] = ControlTableEntry(18, "Alarm Shutdown", 1, 13);
-    mControlTableEntries[14] = ControlTableEntry(20, "Down Calibration", 2, 14);
-    mControlTableEntries[15] = ControlTableEntry(22, "Up Calibration", 2, 15);
-    mControlTableEntries[16] = ControlTableEntry(24, "Torque Enable", 1, 16);
-    mControlTableEntries[17] = ControlTableEntry(25, "LED", 1, 17);
-    mControlTableEntries[18] = ControlTableEntry(26, "CW Compliance Margin", 1, 18);
-    mControlTableEntries[19] = ControlTableEntry(27, "CCW Compliance Margin", 1, 19);
-    mControlTableEntries[20] = ControlTableEntry(28, "CW Compliance Slope", 1, 20);
-    mControlTableEntries[21] = ControlTableEntry(29, "CCW Compliance Slope", 1, 21);
-    mControlTableEntries[22] = ControlTableEntry(30, "Goal Position", 2, 22);
-    mControlTableEntries[23] = ControlTableEntry(32, "Moving Speed", 2, 23);
-    mControlTableEntries[24] = ControlTableEntry(34, "Torque Limit", 2, 24);
-    mControlTableEntries[25] = ControlTableEntry(36, "Present Position", 2, 25);
-    mControlTableEntries[26] = ControlTableEntry(38, "Present Speed", 2, 26);
-    mControlTableEntries[27] = ControlTableEntry(40, "Present Load", 2, 27);
-    mControlTableEntries[28] = ControlTableEntry(42, "Present Voltage", 1, 28);
-    mControlTableEntries[29] = ControlTableEntry(43, "Present Temperature", 1, 29);
-    mControlTableEntries[30] = ControlTableEntry(44, "Registered Instruction", 1, 30);
-    mControlTableEntries[31] = ControlTableEntry(46, "Moving", 1, 31);
-    mControlTableEntries[32] = ControlTableEntry(47, "Lock", 1, 32);
-    mControlTableEntries[33] = ControlTableEntry(48, "Punch", 2, 33);
-
-    //fill the lookup (hash?) map
-    for(int i=0; i<cControlTableEntriesNumber; i++)
-    {
-        mMapStringCTEntry[mControlTableEntries[i].mName] = &(mControlTableEntries[i]);
-    }
-}
-
-bool Dynamixel::writeCommandReadAnswer(int command_length_bytes, servo_dynamixel::ErrorStatus &status )
-{
-    for(unsigned int i = 0; i <= mNumberRetries; ++i) {  
-    try {
-        DX_UINT8 packet_size = 0;
-        if(!mpDynamixelIODriver->writePacket(mCommandBuffer, command_length_bytes))
+    for(unsigned int i=0; i<requests_.size(); i++)
+    {
+        requests_[i].mDone = false;
+    }
+
+    unsigned int next = 0;
+    while(next < requests_.size())
+    {
+        // collect the next window, at most one request per servo
+        std::vector<unsigned int> window;
+        int command_length_bytes = 0;
+        while(next < requests_.size() && window.size() < depth)
         {
-            LOG_ERROR("Packet could not be written");
-            continue;
-        } else {
-            for(int i=0; i<command_length_bytes; i++) {
-                LOG_DEBUG("Write 0x%x(%d)", mCommandBuffer[i], mCommandBuffer[i]);
+            ReadRequest& request = requests_[next];
+            bool duplicate = false;
+            for(unsigned int j=0; j<window.size(); j++)
+            {
+                if(requests_[window[j]].mID == request.mID)
+                {
+                    duplicate = true;
+                }
+            }
+            if(duplicate)
+            {
+                break;
+            }
+            ++next;
+            if(findServo(request.mID) == NULL || request.mID == DX_BROADCAST)
+            {
+                LOG_WARN("Servo ID %d is not available, request ignored", (int)request.mID);
+                continue;
             }
+            if(!isAvailable(findServo(request.mID)))
+            {
+                LOG_DEBUG("Servo ID %d is quarantined, request skipped", (int)request.mID);
+                continue;
+            }
+            DX_UINT8 length;
+            dxGetReadCommand(mCommandBuffer + command_length_bytes, &length,
+                    request.mID, request.mAddress, request.mBytes);
+            command_length_bytes += length;
+            window.push_back(next - 1);
         }
-
-        //will we get a status packet? broadcast means no
-        if(mActiveServoID == DX_BROADCAST)
+        if(window.empty())
         {
-            LOG_DEBUG("Broadcasting ID 0x%x is used, no status packet will be received", DX_BROADCAST);
-            return true;
+            continue;
         }
 
-        if((packet_size = mpDynamixelIODriver->readPacket(mBuffer, cBufferSize)) <= 0)
+        mpDynamixelIODriver->clearExpectedAnswer();
+        for(unsigned int j=0; j<window.size(); j++)
+        {
+            mpDynamixelIODriver->addExpectedAnswer(requests_[window[j]].mID, requests_[window[j]].mBytes);
+        }
+        if(!writeRequest(command_length_bytes))
         {
-            LOG_ERROR("Packet could not be read, %d has been returned", packet_size);
+            LOG_ERROR("Pipelined requests could not be sent");
             continue;
         }
+        base::Time sent = base::Time::now();
 
-	// check error status values
-	// Note, that unlike the other errors, it is still a valid result when an error
-	// bit is set, since the communication worked. The fact that the servo is in an error
-	// state needs to be handled on another level
-        DX_UINT8 error_flags = dxGetStatusErrorFlags(mBuffer);
-        if(error_flags != 0) //error
-        {
-            LOG_WARN("Status packet error returned (0x%x):", error_flags);
-            if(dxInputVoltageErrorOccurred(mBuffer))
-	    {
-		LOG_ERROR("    Input Voltage Error");
-		status.inputVoltageError = true;
-	    }
-            if(dxAngleLimitErrorOccurred(mBuffer))
-	    {
-		LOG_ERROR("    Angle Limit Error");
-		status.angleLimitError = true;
-	    }
-            if(dxOverheatingErrorOccurred(mBuffer))
-	    {
-		LOG_ERROR("    Overheating Error");
-		status.overheatingError = true;
-	    }
-            if(dxRangeErrorOccurred(mBuffer))
-	    {
-		LOG_ERROR("    Range Error");
-		status.rangeError = true;
-	    }
-            if(dxChecksumErrorOccurred(mBuffer))
-	    {
-		LOG_ERROR("    Checksum Error");
-		status.checksumError = true;
-	    }
-            if(dxOverloadErrorOccurred(mBuffer))
-	    {
-		LOG_ERROR("    Overload Error");
-		status.overloadError = true;
-	    }
-            if(dxInstructionErrorOccurred(mBuffer))
-	    {
-		LOG_ERROR("    Instruction Error");
-		status.instructionError = true;
-	    }
-        }
-	else
-	    status.clear();
-
-        if(!dxIsStatusValid(mBuffer, packet_size))
-        {
-            LOG_WARN("Invalid checksum reported");
-            continue;
+        // the answers follow each other, the answer of the j-th request arrives after
+        // the answers and Return Delay Times of the requests in front of it
+        std::vector<base::Time> deadlines;
+        int answer_bytes = 0;
+        base::Time return_delays;
+        for(unsigned int j=0; j<window.size(); j++)
+        {
+            ReadRequest& request = requests_[window[j]];
+            answer_bytes += 6 + request.mBytes;
+            return_delays = return_delays + getReturnDelay(request.mID);
+            deadlines.push_back(sent + (request.mTimeout > 0 ? base::Time::fromMilliseconds(request.mTimeout) :
+                    mpDynamixelIODriver->getAnswerTimeout(command_length_bytes, answer_bytes, return_delays)));
+        }
+
+        // demultiplex the answers by servo ID until all are received or timed out
+        while(!window.empty())
+        {
+            base::Time deadline = deadlines[0];
+            for(unsigned int j=1; j<window.size(); j++)
+            {
+                if(deadlines[j] < deadline)
+                {
+                    deadline = deadlines[j];
+                }
+            }
+
+            int packet_size = 0;
+            try {
+                if(base::Time::now() < deadline)
+                {
+                    packet_size = readPacketUntil(deadline);
+                }
+            } catch(iodrivers_base::UnixError& e) {
+                LOG_ERROR("UnixError catched: %s", e.what());
+            } catch(iodrivers_base::TimeoutError& e) {
+            }
+
+            if(packet_size <= 0)
+            {
+                // drop all requests whose deadline has passed
+                base::Time now = base::Time::now();
+                for(unsigned int j=0; j<window.size(); )
+                {
+                    ReadRequest& request = requests_[window[j]];
+                    if(deadlines[j] <= now)
+                    {
+                        LOG_ERROR("Request to servo %d timed out", (int)request.mID);
+                        recordTransaction(findServo(request.mID), false);
+                        window.erase(window.begin() + j);
+                        deadlines.erase(deadlines.begin() + j);
+                    }
+                    else
+                    {
+                        ++j;
+                    }
+                }
+                continue;
+            }
+
+            StatusPacket status(mBuffer, packet_size);
+            if(!status.isValid())
+            {
+                LOG_WARN("Invalid checksum reported");
+                continue;
+            }
+            DX_UINT8 id = status.getID();
+            unsigned int j = 0;
+            while(j < window.size() && requests_[window[j]].mID != id)
+            {
+                ++j;
+            }
+            if(j == window.size())
+            {
+                LOG_WARN("Unexpected status packet of servo %d discarded", (int)id);
+                continue;
+            }
+            ReadRequest& request = requests_[window[j]];
+            Servo* servo = findServo(id);
+            updateErrorStatus(servo);
+            if(status.getParameterCount() != request.mBytes)
+            {
+                // the framer only passes rejections without parameters, retrying does not help
+                LOG_ERROR("Servo %d rejected the READ (error 0x%x)", (int)id, status.getErrorFlags());
+                recordTransaction(servo, true);
+                window.erase(window.begin() + j);
+                deadlines.erase(deadlines.begin() + j);
+                continue;
+            }
+            setControlTableValues(servo, status, request.mAddress);
+            recordTransaction(servo, true);
+            request.mDone = true;
+            window.erase(window.begin() + j);
+            deadlines.erase(deadlines.begin() + j);
+        }
+    }
+
+    mpDynamixelIODriver->clearExpectedAnswer();
+
+    for(unsigned int i=0; i<requests_.size(); i++)
+    {
+        if(!requests_[i].mDone)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Dynamixel::init(std::string const & uri)
+{
+    return mpDynamixelIODriver->open(uri);
+}
+
+bool Dynamixel::readControlTable()
+{
+    return checkActiveServo() && readControlTable(mActiveServoID);
+}
+
+bool Dynamixel::readControlTable(DX_UINT8 const id_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
+    {
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        return false;
+    }
+
+    DX_UINT8 command_length_bytes;
+    dxGetReadCommand(mCommandBuffer, &command_length_bytes, id_, 0, servo->mControlTable->getLength());
+    if( (writeCommandReadAnswer(command_length_bytes, servo)) && (id_ != DX_BROADCAST) ) //fills the mBuffer, if talking to one specific servo
+    {
+        //fill the control table items
+        setControlTableValues(servo, StatusPacket(mBuffer, cBufferSize), 0);
+        LOG_DEBUG("All controls have been read")
+        return true;
+    }
+    LOG_ERROR("Controls could not be read");
+    return false;
+}
+
+bool Dynamixel::readRegisters(std::vector<RegisterId> const& registers_)
+{
+    return checkActiveServo() && readRegisters(mActiveServoID, registers_);
+}
+
+bool Dynamixel::readRegisters(DX_UINT8 const id_, std::vector<RegisterId> const& registers_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
+    {
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        return false;
+    }
+
+    if(id_ == DX_BROADCAST)
+    {
+        LOG_WARN("Control table entries can not be read using the broadcast ID");
+        return false;
+    }
+
+    // the entries are ordered by address, so sorting the numbers sorts the addresses
+    ControlTable const& table = *servo->mControlTable;
+    std::vector<RegisterId> numbers(registers_);
+    std::sort(numbers.begin(), numbers.end());
+    numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+
+    unsigned int i = 0;
+    while(i < numbers.size())
+    {
+        ControlTableEntry const* entry = table.findByNumber(numbers[i]);
+        if(entry == NULL)
+        {
+            LOG_WARN("Control table entry %d is unknown", numbers[i]);
+            return false;
+        }
+        // extend the range as long as the next entry is close enough
+        int start = entry->mAddress;
+        int end = start + entry->mBytes;
+        ++i;
+        while(i < numbers.size() && (entry = table.findByNumber(numbers[i])) != NULL &&
+                entry->mAddress <= end + (int)mReadGapTolerance)
+        {
+            end = entry->mAddress + entry->mBytes;
+            ++i;
+        }
+
+        DX_UINT8 command_length_bytes;
+        dxGetReadCommand(mCommandBuffer, &command_length_bytes, id_, start, end - start);
+        if(!writeCommandReadAnswer(command_length_bytes, servo))
+        {
+            LOG_ERROR("Control table range %d-%d could not be read", start, end - 1);
+            return false;
+        }
+        setControlTableValues(servo, StatusPacket(mBuffer, cBufferSize), start);
+        LOG_DEBUG("Control table range %d-%d has been read", start, end - 1);
+    }
+    return true;
+}
+
+bool Dynamixel::setControlTableEntry(std::string item_name, uint16_t const value_)
+{
+    return checkActiveServo() && setControlTableEntry(mActiveServoID, item_name, value_);
+}
+
+bool Dynamixel::setControlTableEntry(DX_UINT8 const id_, std::string item_name, uint16_t const value_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
+    {
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        return false;
+    }
+    ControlTableEntry const* entry = servo->mControlTable->findByName(item_name);
+    if(entry == NULL)
+    {
+        LOG_WARN("Control table entry name %s is unknown", item_name.c_str());
+        return false;
+    }
+    return writeEntry(id_, entry->mNumber, entry->mAddress, entry->mBytes, value_);
+}
+
+servo_dynamixel::ErrorStatus Dynamixel::getErrorStatus()
+{
+    return mpActiveServo->status;
+}
+
+servo_dynamixel::ErrorStatus Dynamixel::getErrorStatus(DX_UINT8 const id_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
+    {
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        servo_dynamixel::ErrorStatus status;
+        status.clear();
+        return status;
+    }
+    return servo->status;
+}
+
+bool Dynamixel::isErrorStatusOk()
+{
+    return checkActiveServo() && isErrorStatusOk(mActiveServoID);
+}
+
+bool Dynamixel::isErrorStatusOk(DX_UINT8 const id_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
+    {
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        return false;
+    }
+
+    if( servo->status.hasError() )
+    {
+        LOG_ERROR("Dynamixel error status is not ok");
+	return false;
+    }
+
+    return true;
+}
+
+bool Dynamixel::setGoalPosition(uint16_t const pos_)
+{
+    return checkActiveServo() && setGoalPosition(mActiveServoID, pos_);
+}
+
+bool Dynamixel::setGoalPosition(DX_UINT8 const id_, uint16_t const pos_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
+    {
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        return false;
+    }
+
+    if(mWriteCache)
+    {
+        cacheValue(servo, dx::GoalPosition::number, pos_);
+        return true;
+    }
+
+    int command_length_bytes = dx::WritePacket<dx::GoalPosition>::encode(mCommandBuffer, id_, pos_);
+    if(writeCommandReadAnswer(command_length_bytes, servo))
+    {
+        storeWrittenValue(servo, dx::GoalPosition::number, pos_);
+        LOG_DEBUG("Servo %d set to %hu (steps)", id_, pos_);
+
+        return isErrorStatusOk(id_);
+    }
+    LOG_ERROR("Servo %d position could not be changed", id_);
+    return false;
+}
+
+bool Dynamixel::setMovement(DX_UINT8 const id_, DxMovement const& movement_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
+    {
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        return false;
+    }
+
+    int command_length_bytes = encodeMovement(id_, DX_WRITE, movement_);
+    if(writeCommandReadAnswer(command_length_bytes, servo))
+    {
+        storeMovement(servo, movement_);
+        return isErrorStatusOk(id_);
+    }
+    LOG_ERROR("Servo %d movement could not be changed", id_);
+    return false;
+}
+
+bool Dynamixel::syncWrite(DX_UINT8 const address_, DX_UINT8 const length_,
+        std::vector<DX_UINT8> const& ids_, std::vector<uint16_t> const& values_)
+{
+    if(ids_.size() != values_.size())
+    {
+        LOG_WARN("Number of IDs (%d) and values (%d) differ", (int)ids_.size(), (int)values_.size());
+        return false;
+    }
+    if(length_ < 1 || length_ > 2)
+    {
+        LOG_WARN("Sync write supports 1 or 2 bytes per servo, %d requested", (int)length_);
+        return false;
+    }
+    // 4 bytes header, 4 bytes instruction/address/length/checksum
+    if(ids_.empty() || ids_.size() * (length_ + 1) + 8 > cCommandBufferSize)
+    {
+        LOG_WARN("Sync write of %d servos does not fit into one packet", (int)ids_.size());
+        return false;
+    }
+
+    // values are transmitted in little endian
+    DX_UINT8 data[cCommandBufferSize];
+    for(unsigned int i=0; i<values_.size(); i++)
+    {
+        dx::putLittleEndian(data + i * length_, values_[i], length_);
+    }
+
+    DX_UINT8 command_length_bytes;
+    dxGetSyncWriteCommand(mCommandBuffer, &command_length_bytes, address_, length_,
+            &ids_[0], data, ids_.size());
+    if(!writeCommand(command_length_bytes))
+    {
+        LOG_ERROR("Sync write to address %d could not be sent", (int)address_);
+        return false;
+    }
+
+    for(unsigned int i=0; i<ids_.size(); i++)
+    {
+        Servo* servo = findServo(ids_[i]);
+        if(servo == NULL)
+        {
+            continue;
+        }
+        ControlTableEntry const* entry = servo->mControlTable->findByAddress(address_);
+        if(entry != NULL && entry->mBytes == length_)
+        {
+            storeWrittenValue(servo, entry->mNumber, values_[i]);
+        }
+    }
+    LOG_DEBUG("Sync write of %d servos to address %d", (int)ids_.size(), (int)address_);
+    return true;
+}
+
+bool Dynamixel::setGoalPositions(std::vector<DX_UINT8> const& ids_, std::vector<uint16_t> const& positions_)
+{
+    return syncWrite(dx::GoalPosition::address, dx::GoalPosition::bytes, ids_, positions_);
+}
+
+DX_UINT8 Dynamixel::getStatusReturnLevel(DX_UINT8 const id_)
+{
+    // a cached write does not change the level before it is flushed
+    Servo* servo = findServo(id_);
+    uint16_t level;
+    if(servo == NULL || !getConfirmedValue(servo, dx::StatusReturnLevel::number, level))
+    {
+        return DX_FULL_RESPONSE;
+    }
+    return level;
+}
+
+bool Dynamixel::setStatusReturnLevel(DX_UINT8 const level_)
+{
+    if(level_ > DX_FULL_RESPONSE)
+    {
+        LOG_WARN("Invalid Status Return Level %d", (int)level_);
+        return false;
+    }
+    int command_length_bytes = dx::WritePacket<dx::StatusReturnLevel>::encode(mCommandBuffer, DX_BROADCAST, level_);
+    if(!writeCommand(command_length_bytes))
+    {
+        LOG_ERROR("Status Return Level could not be changed");
+        return false;
+    }
+    for(unsigned int i=0; i<mServoList.size(); i++)
+    {
+        storeWrittenValue(mServoList[i], dx::StatusReturnLevel::number, level_);
+    }
+    LOG_INFO("Status Return Level of all servos set to %d", (int)level_);
+    return true;
+}
+
+bool Dynamixel::isQuarantined(DX_UINT8 const id_)
+{
+    Servo* servo = findServo(id_);
+    return servo != NULL && servo->mQuarantined;
+}
+
+void Dynamixel::openBatch()
+{
+    if(mBatchOpen && mBatchSize > 0)
+    {
+        LOG_WARN("Transmit batch of %d bytes has not been committed and is discarded", mBatchSize);
+    }
+    mBatchOpen = true;
+    mBatchSize = 0;
+    mBatchValues.clear();
+}
+
+bool Dynamixel::batchAction()
+{
+    DX_UINT8 packet[6];
+    return addToBatch(packet, dx::PacketBuilder(packet, DX_BROADCAST, DX_ACTION).finish());
+}
+
+bool Dynamixel::addToBatch(DX_UINT8 const* packet_, int const size_)
+{
+    if(!mBatchOpen)
+    {
+        LOG_WARN("No transmit batch is open, use openBatch() first");
+        return false;
+    }
+    if(expectsStatusPacket(packet_))
+    {
+        // the answer would collide with the following packets of the batch
+        LOG_WARN("Servo ID %d answers instruction 0x%x, packet is not staged", (int)packet_[2], packet_[4]);
+        return false;
+    }
+    if(mBatchSize + size_ > cBatchBufferSize)
+    {
+        LOG_WARN("Transmit batch is full, packet of %d bytes is not staged", size_);
+        return false;
+    }
+    std::copy(packet_, packet_ + size_, mBatchBuffer + mBatchSize);
+    mBatchSize += size_;
+    return true;
+}
+
+bool Dynamixel::commitBatch()
+{
+    if(!mBatchOpen)
+    {
+        LOG_WARN("No transmit batch is open, use openBatch() first");
+        return false;
+    }
+    mBatchOpen = false;
+    if(mBatchSize == 0)
+    {
+        return true;
+    }
+    if(!writeBuffer(mBatchBuffer, mBatchSize))
+    {
+        LOG_ERROR("Transmit batch of %d bytes could not be sent", mBatchSize);
+        return false;
+    }
+
+    for(unsigned int i=0; i<mBatchValues.size(); i++)
+    {
+        storeWrittenValue(findServo(mBatchValues[i].mID), mBatchValues[i].mNumber, mBatchValues[i].mValue);
+    }
+    LOG_DEBUG("Transmit batch of %d bytes sent", mBatchSize);
+    return true;
+}
+
+bool Dynamixel::stageMovement(DX_UINT8 const id_, DxMovement const& movement_)
+{
+    if(findServo(id_) == NULL)
+    {
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        return false;
+    }
+    for(unsigned int i=0; i<mStagedMovements.size(); i++)
+    {
+        if(mStagedMovements[i].first == id_)
+        {
+            mStagedMovements[i].second = movement_;
+            return true;
+        }
+    }
+    mStagedMovements.push_back(std::make_pair(id_, movement_));
+    return true;
+}
+
+bool Dynamixel::triggerMovements()
+{
+    std::vector<std::pair<DX_UINT8, DxMovement> > movements;
+    movements.swap(mStagedMovements);
+    if(movements.empty())
+    {
+        return true;
+    }
+
+    for(unsigned int i=0; i<movements.size(); i++)
+    {
+        Servo* servo = findServo(movements[i].first);
+        int command_length_bytes = encodeMovement(movements[i].first, DX_REGWRITE, movements[i].second);
+        if(!writeCommandReadAnswer(command_length_bytes, servo))
+        {
+            LOG_ERROR("Movement of servo %d could not be registered, no movement is started",
+                    (int)movements[i].first);
+            // the failed REG_WRITE may have been applied with only its answer lost
+            unregisterMovements(movements, i + 1);
+            return false;
+        }
+    }
+
+    int command_length_bytes = dx::PacketBuilder(mCommandBuffer, DX_BROADCAST, DX_ACTION).finish();
+    if(!writeCommand(command_length_bytes))
+    {
+        LOG_ERROR("ACTION could not be sent, %d movements are not started", (int)movements.size());
+        unregisterMovements(movements, movements.size());
+        return false;
+    }
+    for(unsigned int i=0; i<movements.size(); i++)
+    {
+        storeMovement(findServo(movements[i].first), movements[i].second);
+    }
+    LOG_DEBUG("%d movements started", (int)movements.size());
+    return true;
+}
+
+void Dynamixel::unregisterMovements(std::vector<std::pair<DX_UINT8, DxMovement> > const& movements_,
+        unsigned int const count_)
+{
+    for(unsigned int i=0; i<count_; i++)
+    {
+        Servo* servo = findServo(movements_[i].first);
+        uint16_t goal_position, moving_speed, torque_limit;
+        if(!getConfirmedValue(servo, dx::GoalPosition::number, goal_position) ||
+                !getConfirmedValue(servo, dx::MovingSpeed::number, moving_speed) ||
+                !getConfirmedValue(servo, dx::TorqueLimit::number, torque_limit))
+        {
+            LOG_WARN("Movement of servo %d stays registered, the next ACTION starts it", (int)servo->mID);
+            continue;
+        }
+        DxMovement current;
+        current.goalPosition = goal_position;
+        current.movingSpeed = moving_speed;
+        current.torqueLimit = torque_limit;
+        int command_length_bytes = encodeMovement(servo->mID, DX_REGWRITE, current);
+        if(!writeCommandReadAnswer(command_length_bytes, servo))
+        {
+            LOG_WARN("Movement of servo %d stays registered, the next ACTION starts it", (int)servo->mID);
+        }
+    }
+}
+
+void Dynamixel::clearMovements()
+{
+    mStagedMovements.clear();
+}
+
+Dynamixel::Servo* Dynamixel::setServoActive(DX_UINT8 id_)
+{
+    Servo* servo = findServo(id_);
+    if(servo != NULL)
+    {
+        mActiveServoID = id_;
+        mpActiveServo = servo;
+        LOG_INFO("Servo ID %d activated", id_);
+        return servo;
+    }
+    LOG_WARN("Servo ID %d is not available and could not be activated", id_);
+    return NULL;
+}
+
+bool Dynamixel::getControlTableEntry(std::string const name, ControlTableEntry& entry) {
+    ControlTable const& table = mpActiveServo != NULL ? *mpActiveServo->mControlTable : ControlTable::getDefault();
+    ControlTableEntry const* found = table.findByName(name);
+    if(found != NULL) {
+        entry = *found;
+        return true;
+    }
+    LOG_WARN("Control table entry %s is unknown", name.c_str());
+    return false;
+}
+
+std::vector<Dynamixel::Servo> Dynamixel::getServoListCopy() {
+    std::vector<struct Servo> servo_list_copy;
+    for(unsigned int i=0; i < mServoList.size(); ++i) {
+        servo_list_copy.push_back(*(mServoList.at(i)));
+    }
+    return servo_list_copy;
+}
+
+/////////////////////////////// PRIVATE //////////////////////////////////////
+bool Dynamixel::readEntry(DX_UINT8 const id_, int const number_, int const address_, int const bytes_, uint16_t * const value_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
+    {
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        return false;
+    }
+    if(!checkEntry(servo, number_, address_, bytes_))
+    {
+        return false;
+    }
+
+     DX_UINT8 command_length_bytes;
+     dxGetReadCommand(mCommandBuffer,
+         &command_length_bytes,
+         id_,
+         address_,
+         bytes_);
+     if(writeCommandReadAnswer(command_length_bytes, servo))
+     {
+        uint16_t value_temp = StatusPacket(mBuffer, cBufferSize).getValue(0, bytes_);
+        *value_ = value_temp;
+        //update the control table entry of the servo with the ID id_,
+        //the array position is listed in the entry object
+        storeReadValue(servo, number_, value_temp);
+        LOG_INFO("Control table entry %s has been changed to %d", getEntryName(servo, number_), value_temp);
+        return true;
+     }
+     return false;
+}
+
+bool Dynamixel::writeEntry(DX_UINT8 const id_, int const number_, int const address_, int const bytes_, uint16_t const value_)
+{
+    Servo* servo = findServo(id_);
+    if(servo == NULL)
+    {
+        LOG_WARN("Servo ID %d is not available", (int)id_);
+        return false;
+    }
+    if(!checkEntry(servo, number_, address_, bytes_))
+    {
+        return false;
+    }
+
+    if(mWriteCache)
+    {
+        cacheValue(servo, number_, value_);
+        return true;
+    }
+
+    int command_length_bytes = dx::PacketBuilder(mCommandBuffer, id_, DX_WRITE)
+        .add8(address_).add(value_, bytes_).finish();
+    if(writeCommandReadAnswer(command_length_bytes, servo))
+    {
+        storeWrittenValue(servo, number_, value_);
+        LOG_INFO("Control table entry %s has been set to %hu", getEntryName(servo, number_), value_);
+
+        return isErrorStatusOk(id_);
+    }
+    LOG_ERROR("Control table entry %s could not be changed to %hu", getEntryName(servo, number_), value_);
+    return false;
+}
+
+int Dynamixel::encodeMovement(DX_UINT8 const id_, DX_UINT8 const instruction_, DxMovement const& movement_)
+{
+    // Goal Position, Moving Speed and Torque Limit are contiguous
+    return dx::PacketBuilder(mCommandBuffer, id_, instruction_).add8(dx::GoalPosition::address).
+            add16(movement_.goalPosition).add16(movement_.movingSpeed).add16(movement_.torqueLimit).finish();
+}
+
+void Dynamixel::storeMovement(Servo* servo_, DxMovement const& movement_)
+{
+    storeWrittenValue(servo_, dx::GoalPosition::number, movement_.goalPosition);
+    storeWrittenValue(servo_, dx::MovingSpeed::number, movement_.movingSpeed);
+    storeWrittenValue(servo_, dx::TorqueLimit::number, movement_.torqueLimit);
+}
+
+bool Dynamixel::addWriteToBatch(DX_UINT8 const id_, DX_UINT8 const instruction_, int const number_,
+        int const address_, int const bytes_, uint16_t const value_)
+{
+    if(id_ != DX_BROADCAST)
+    {
+        Servo* servo = findServo(id_);
+        if(servo == NULL)
+        {
+            LOG_WARN("Servo ID %d is not available", (int)id_);
+            return false;
+        }
+        if(!checkEntry(servo, number_, address_, bytes_))
+        {
+            return false;
+        }
+    }
+
+    DX_UINT8 packet[9];
+    int size = dx::PacketBuilder(packet, id_, instruction_).add8(address_).add(value_, bytes_).finish();
+    if(!addToBatch(packet, size))
+    {
+        return false;
+    }
+    if(instruction_ == DX_WRITE && id_ != DX_BROADCAST)
+    {
+        BatchValue value = {id_, number_, value_};
+        mBatchValues.push_back(value);
+    }
+    return true;
+}
+
+Dynamixel::Servo* Dynamixel::findServo(DX_UINT8 const id_)
+{
+    return id_ < cServoTableSize ? mServoTable[id_] : NULL;
+}
+
+bool Dynamixel::checkEntry(Servo const* servo_, int const number_, int const address_, int const bytes_)
+{
+    ControlTableEntry const* entry = servo_->mControlTable->findByNumber(number_);
+    if(entry == NULL || entry->mAddress != address_ || entry->mBytes != bytes_)
+    {
+        LOG_WARN("Control table entry %d (address %d) is not available on servo %d",
+                number_, address_, (int)servo_->mID);
+        return false;
+    }
+    return true;
+}
+
+bool Dynamixel::checkActiveServo()
+{
+    if(mpActiveServo == NULL)
+    {
+        LOG_WARN("No active servo available, use setServoActive() first");
+        return false;
+    }
+    return true;
+}
+
+char const* Dynamixel::getEntryName(Servo* servo_, int const number_)
+{
+    ControlTableEntry const* entry = servo_->mControlTable->findByNumber(number_);
+    return entry != NULL ? entry->mName.c_str() : "(unknown)";
+}
+
+void Dynamixel::setControlTableValues(Servo* servo_, StatusPacket const& status_, int const address_)
+{
+    ControlTable const& table = *servo_->mControlTable;
+    for(int i=0; i<table.size(); i++)
+    {
+        ControlTableEntry const& entry = table[i];
+        if(status_.contains(address_, entry.mAddress, entry.mBytes))
+        {
+            storeReadValue(servo_, entry.mNumber, status_.getValue(entry.mAddress - address_, entry.mBytes));
+        }
+    }
+}
+
+void Dynamixel::storeReadValue(Servo* servo_, int const number_, uint16_t const value_)
+{
+    if(servo_->mDirty[number_])
+    {
+        if(servo_->mKnown[number_])
+        {
+            servo_->mConfirmedValues[number_] = value_;
+        }
+        return;
+    }
+    servo_->mControlTableValues[number_] = value_;
+    servo_->mConfirmedValues[number_] = value_;
+    servo_->mKnown[number_] = true;
+    mState.setControlTableValue(servo_->mIndex, number_, value_);
+}
+
+void Dynamixel::storeWrittenValue(Servo* servo_, int const number_, uint16_t const value_)
+{
+    servo_->mControlTableValues[number_] = value_;
+    servo_->mConfirmedValues[number_] = value_;
+    servo_->mKnown[number_] = true;
+    servo_->mDirty[number_] = false;
+    mState.setControlTableValue(servo_->mIndex, number_, value_);
+}
+
+void Dynamixel::cacheValue(Servo* servo_, int const number_, uint16_t const value_)
+{
+    if(!servo_->mDirty[number_] && servo_->mKnown[number_] &&
+            servo_->mControlTableValues[number_] == value_)
+    {
+        LOG_DEBUG("Control table entry %d of servo %d unchanged", number_, (int)servo_->mID);
+        return;
+    }
+    servo_->mControlTableValues[number_] = value_;
+    servo_->mDirty[number_] = true;
+}
+
+bool Dynamixel::getConfirmedValue(Servo const* servo_, int const number_, uint16_t& value_) const
+{
+    if(!servo_->mKnown[number_])
+    {
+        return false;
+    }
+    value_ = servo_->mConfirmedValues[number_];
+    return true;
+}
+
+void Dynamixel::updateErrorStatus(Servo* servo_)
+{
+    servo_dynamixel::ErrorStatus& status = servo_->status;
+    DX_UINT8 error_flags = dxGetStatusErrorFlags(mBuffer);
+    if(error_flags != 0) //error
+    {
+        LOG_WARN("Status packet error returned (0x%x):", error_flags);
+        if(dxInputVoltageErrorOccurred(mBuffer))
+        {
+            LOG_ERROR("    Input Voltage Error");
+            status.inputVoltageError = true;
+        }
+        if(dxAngleLimitErrorOccurred(mBuffer))
+        {
+            LOG_ERROR("    Angle Limit Error");
+            status.angleLimitError = true;
+        }
+        if(dxOverheatingErrorOccurred(mBuffer))
+        {
+            LOG_ERROR("    Overheating Error");
+            status.overheatingError = true;
+        }
+        if(dxRangeErrorOccurred(mBuffer))
+        {
+            LOG_ERROR("    Range Error");
+            status.rangeError = true;
+        }
+        if(dxChecksumErrorOccurred(mBuffer))
+        {
+            LOG_ERROR("    Checksum Error");
+            status.checksumError = true;
+        }
+        if(dxOverloadErrorOccurred(mBuffer))
+        {
+            LOG_ERROR("    Overload Error");
+            status.overloadError = true;
+        }
+        if(dxInstructionErrorOccurred(mBuffer))
+        {
+            LOG_ERROR("    Instruction Error");
+            status.instructionError = true;
+        }
+    }
+    else
+        status.clear();
+
+    mState.setErrorStatus(servo_->mIndex, status);
+}
+
+void Dynamixel::updateErrorStatus2(Servo* servo_, DX_UINT8 const error_)
+{
+    servo_dynamixel::ErrorStatus& status = servo_->status;
+    status.clear();
+    if(error_ == 0)
+    {
+        mState.setErrorStatus(servo_->mIndex, status);
+        return;
+    }
+    LOG_WARN("Status packet error returned (0x%x):", error_);
+    if(error_ & DX2_ALERT)
+    {
+        LOG_ERROR("    Hardware Error");
+        status.hardwareError = true;
+    }
+    switch(error_ & DX2_ERROR_NUMBER_MASK)
+    {
+        case 0:
+            break;
+        case DX2_CRC_ERROR:
+            LOG_ERROR("    CRC Error");
+            status.checksumError = true;
+            break;
+        case DX2_DATA_RANGE_ERROR:
+        case DX2_DATA_LENGTH_ERROR:
+        case DX2_DATA_LIMIT_ERROR:
+            LOG_ERROR("    Range Error");
+            status.rangeError = true;
+            break;
+        default:
+            LOG_ERROR("    Instruction Error");
+            status.instructionError = true;
+            break;
+    }
+    mState.setErrorStatus(servo_->mIndex, status);
+}
+
+void Dynamixel::setPresentValues2(Servo* servo_, DX_UINT8 const* data_)
+{
+    // current, velocity, position
+    servo_->mPresentValues2.presentCurrent = (DX_INT16)(data_[0] | (data_[1] << 8));
+    servo_->mPresentValues2.presentVelocity = (DX_INT32)((uint32_t)data_[2] | ((uint32_t)data_[3] << 8) |
+            ((uint32_t)data_[4] << 16) | ((uint32_t)data_[5] << 24));
+    servo_->mPresentValues2.presentPosition = (DX_INT32)((uint32_t)data_[6] | ((uint32_t)data_[7] << 8) |
+            ((uint32_t)data_[8] << 16) | ((uint32_t)data_[9] << 24));
+    mState.setPresentValues2(servo_->mIndex, servo_->mPresentValues2);
+}
+
+bool Dynamixel::writeCommand(int command_length_bytes)
+{
+    return writeBuffer(mCommandBuffer, command_length_bytes);
+}
+
+bool Dynamixel::writeRequest(int command_length_bytes)
+{
+    mpDynamixelIODriver->clear();
+    return writeCommand(command_length_bytes);
+}
+
+bool Dynamixel::writeBuffer(DX_UINT8 const* buffer_, int const size_)
+{
+    for(unsigned int i = 0; i <= mRetryPolicy.mWriteRetries; ++i) {
+    try {
+        if(mpDynamixelIODriver->writePacket(buffer_, size_))
+        {
+            for(int i=0; i<size_; i++) {
+                LOG_DEBUG("Write 0x%x(%d)", buffer_[i], buffer_[i]);
+            }
+            return true;
+        }
+        LOG_ERROR("Packet could not be written");
+    } catch(iodrivers_base::UnixError& e) {
+        LOG_ERROR("UnixError catched: %s", e.what());
+    } catch(iodrivers_base::TimeoutError& e) {
+        LOG_ERROR("TimeoutError catched: %s", e.what());
+    }
+    } // for loop
+    return false;
+}
+
+bool Dynamixel::expectsStatusPacket(DX_UINT8 const* command_)
+{
+    DX_UINT8 id = command_[2];
+    DX_UINT8 instruction = command_[4];
+    if(id == DX_BROADCAST)
+    {
+        return false;
+    }
+    if(instruction == DX_PING)
+    {
+        return true;
+    }
+
+    int level = getStatusReturnLevel(id);
+    if(instruction == DX_WRITE)
+    {
+        // parameters: address and data
+        int address = command_[5];
+        int bytes = command_[3] - 3;
+        if(address <= dx::StatusReturnLevel::address && dx::StatusReturnLevel::address < address + bytes)
+        {
+            level = command_[6 + dx::StatusReturnLevel::address - address];
+        }
+    }
+    return instruction == DX_READ ? level >= DX_READ_ONLY : level >= DX_FULL_RESPONSE;
+}
+
+base::Time Dynamixel::getAnswerTimeout(DX_UINT8 const* command_, int command_length_bytes)
+{
+    if(mpDynamixelIODriver->getProtocol() != DynamixelIODriver::PROTOCOL_1)
+    {
+        return base::Time::fromMilliseconds(mpDynamixelIODriver->getTimeout());
+    }
+    // a READ is answered with the requested bytes, all other instructions without parameters
+    int answer_bytes = 6;
+    if(command_[4] == DX_READ)
+    {
+        answer_bytes += command_[6];
+    }
+    return mpDynamixelIODriver->getAnswerTimeout(command_length_bytes, answer_bytes,
+            getReturnDelay(command_[2]));
+}
+
+base::Time Dynamixel::getReturnDelay(DX_UINT8 const id_)
+{
+    // Return Delay Time in 2 us, 250 is the factory default
+    uint16_t return_delay = 250;
+    Servo* servo = findServo(id_);
+    if(servo != NULL)
+    {
+        getConfirmedValue(servo, dx::ReturnDelayTime::number, return_delay);
+    }
+    return base::Time::fromMicroseconds(return_delay * 2);
+}
+
+int Dynamixel::readPacketUntil(base::Time const& deadline_)
+{
+    base::Time remaining = deadline_ - base::Time::now();
+    if(remaining < base::Time())
+    {
+        remaining = base::Time();
+    }
+    return mpDynamixelIODriver->readPacket(mBuffer, cBufferSize, remaining);
+}
+
+Dynamixel::TransactionResult Dynamixel::transact(DX_UINT8 const* command_, int const command_length_,
+        DX_UINT8& error_flags_)
+{
+    error_flags_ = 0;
+    mLastStatusSize = 0;
+    DynamixelIODriver::TransferResult result = mpDynamixelIODriver->tryWritePacket(command_, command_length_,
+            base::Time::fromMilliseconds(mpDynamixelIODriver->getTimeout()));
+    if(result != DynamixelIODriver::TRANSFER_OK)
+    {
+        return TRANSACTION_WRITE_FAILED;
+    }
+
+    //will we get a status packet? broadcast or the Status Return Level means no
+    if(!expectsStatusPacket(command_))
+    {
+        return TRANSACTION_OK;
+    }
+
+    // only the answer of this request is accepted: PING and all instructions except
+    // READ are answered without parameters
+    int parameters = command_[4] == DX_READ ? command_[6] : 0;
+    mpDynamixelIODriver->setExpectedAnswer(command_[2], parameters);
+    int packet_size = 0;
+    result = mpDynamixelIODriver->tryReadPacket(mBuffer, cBufferSize,
+            getAnswerTimeout(command_, command_length_), packet_size);
+    mpDynamixelIODriver->clearExpectedAnswer();
+    if(result != DynamixelIODriver::TRANSFER_OK)
+    {
+        return result == DynamixelIODriver::TRANSFER_TIMEOUT ? TRANSACTION_TIMEOUT : TRANSACTION_IO_ERROR;
+    }
+    StatusPacket status(mBuffer, packet_size);
+    if(!status.isValid())
+    {
+        return TRANSACTION_INVALID_PACKET;
+    }
+    error_flags_ = status.getErrorFlags();
+    mLastStatusSize = packet_size;
+    return TRANSACTION_OK;
+}
+
+bool Dynamixel::writeCommandReadAnswer(int command_length_bytes, Servo* servo_)
+{
+    if(!isAvailable(servo_))
+    {
+        LOG_DEBUG("Servo ID %d is quarantined, command skipped", (int)mCommandBuffer[2]);
+        return false;
+    }
+
+    DX_UINT8 instruction = mCommandBuffer[4];
+    bool reading = instruction == DX_READ || instruction == DX_PING;
+    if(reading && !expectsStatusPacket(mCommandBuffer))
+    {
+        // only the status packet carries the result, mBuffer would keep stale bytes
+        LOG_ERROR("Servo ID %d does not answer instruction 0x%x, see the Status Return Level",
+                (int)mCommandBuffer[2], (int)instruction);
+        return false;
+    }
+    unsigned int retries = reading ? mRetryPolicy.mReadRetries : mRetryPolicy.mWriteRetries;
+    // a request which has not been sent cannot be answered, the servo is not to blame
+    bool sent = false;
+    bool answered = false;
+    // the bus needs a pause only if the previous attempt used it
+    bool backoff = false;
+    for(unsigned int i = 0; i <= retries; ++i) {
+        if(i > 0)
+        {
+            // a late answer arriving during the backoff is discarded by the next transact()
+            ++mTransactionCounters.mRetries;
+            if(backoff)
+            {
+                retryBackoff(i);
+            }
+        }
+        for(int i=0; i<command_length_bytes; i++) {
+            LOG_DEBUG("Write 0x%x(%d)", mCommandBuffer[i], mCommandBuffer[i]);
+        }
+
+        DX_UINT8 error_flags = 0;
+        base::Time start = base::Time::now();
+        TransactionResult result = transact(mCommandBuffer, command_length_bytes, error_flags);
+        mTransactionCounters.mCount[result]++;
+        mTransactionCounters.mTime[result] = mTransactionCounters.mTime[result] + (base::Time::now() - start);
+        sent = sent || result != TRANSACTION_WRITE_FAILED;
+        switch(result)
+        {
+            case TRANSACTION_OK:
+                break;
+            case TRANSACTION_WRITE_FAILED:
+                // host side, nothing has been sent which the servos could answer
+                LOG_ERROR("Packet could not be written");
+                backoff = false;
+                continue;
+            case TRANSACTION_TIMEOUT:
+                LOG_ERROR("No status packet received from ID 0x%x", mCommandBuffer[2]);
+                backoff = true;
+                continue;
+            case TRANSACTION_IO_ERROR:
+                // the port itself failed, a retry would fail the same way
+                LOG_ERROR("Packet could not be read");
+                return false;
+            case TRANSACTION_INVALID_PACKET:
+                LOG_WARN("Invalid checksum reported");
+                backoff = true;
+                continue;
+        }
+
+        if(mLastStatusSize == 0)
+        {
+            LOG_DEBUG("No status packet will be received from ID 0x%x", mCommandBuffer[2]);
+            return true;
+        }
+
+	// check error status values
+	// Note, that unlike the other errors, it is still a valid result when an error
+	// bit is set, since the communication worked. The fact that the servo is in an error
+	// state needs to be handled on another level
+        updateErrorStatus(servo_);
+        recordTransaction(servo_, true);
+        answered = true;
+        if(error_flags & DX_CHECKSUM_ERROR)
+        {
+            // the request has been corrupted on the bus, it may pass the next time
+            LOG_WARN("Servo %d received a corrupted instruction packet", (int)mCommandBuffer[2]);
+            backoff = true;
+            continue;
+        }
+        // a rejected READ is answered without the requested bytes, retrying does not help
+        if(instruction == DX_READ && getLastStatus().getParameterCount() != mCommandBuffer[6])
+        {
+            LOG_ERROR("Servo %d rejected the READ (error 0x%x)", (int)mCommandBuffer[2],
+                    getLastStatus().getErrorFlags());
+            return false;
+        }
+        return true;
+    } // for loop
+    if(sent && !answered && expectsStatusPacket(mCommandBuffer))
+    {
+        recordTransaction(servo_, false);
+    }
+    return false;
+}
+
+void Dynamixel::retryBackoff(unsigned int const retry_)
+{
+    base::Time backoff = mRetryPolicy.mBackoff;
+    for(unsigned int i=1; i<retry_ && backoff < mRetryPolicy.mMaxBackoff; i++)
+    {
+        backoff = backoff + backoff;
+    }
+    if(backoff > mRetryPolicy.mMaxBackoff)
+    {
+        backoff = mRetryPolicy.mMaxBackoff;
+    }
+    if(backoff.toMicroseconds() > 0)
+    {
+        usleep(backoff.toMicroseconds());
+    }
+}
+
+bool Dynamixel::isAvailable(Servo* servo_)
+{
+    if(!servo_->mQuarantined)
+    {
+        return true;
+    }
+    base::Time now = base::Time::now();
+    if(now < servo_->mNextProbe)
+    {
+        return false;
+    }
+
+    bool answered = false;
+    if(mpDynamixelIODriver->getProtocol() == DynamixelIODriver::PROTOCOL_2)
+    {
+        DX_UINT8 command[DX2_HEADER_SIZE + 5];
+        DX_UINT16 command_length_bytes;
+        dx2GetPingCommand(command, &command_length_bytes, servo_->mID);
+        int packet_size = 0;
+        answered = mpDynamixelIODriver->tryWritePacket(command, command_length_bytes,
+                    base::Time::fromMilliseconds(mpDynamixelIODriver->getTimeout())) == DynamixelIODriver::TRANSFER_OK &&
+                mpDynamixelIODriver->tryReadPacket(mBuffer, cBufferSize,
+                    mpDynamixelIODriver->getAnswerTimeout(command_length_bytes, 14, getReturnDelay(servo_->mID)),
+                    packet_size) == DynamixelIODriver::TRANSFER_OK &&
+                dx2IsStatusValid(mBuffer, packet_size) && dx2GetStatusID(mBuffer) == servo_->mID;
+    }
+    else
+    {
+        DX_UINT8 command[6];
+        DX_UINT8 command_length_bytes;
+        dxGetPingCommand(command, &command_length_bytes, servo_->mID);
+        DX_UINT8 error_flags;
+        answered = transact(command, command_length_bytes, error_flags) == TRANSACTION_OK;
+    }
+    if(answered)
+    {
+        recordTransaction(servo_, true);
+        return true;
+    }
+    servo_->mNextProbe = now + mProbeInterval;
+    return false;
+}
+
+void Dynamixel::recordTransaction(Servo* servo_, bool const answered_)
+{
+    if(answered_)
+    {
+        if(servo_->mQuarantined)
+        {
+            LOG_INFO("Servo ID %d answers again and is reinstated", (int)servo_->mID);
+        }
+        servo_->mFailures = 0;
+        servo_->mQuarantined = false;
+        return;
+    }
+
+    ++servo_->mFailures;
+    if(mQuarantineThreshold > 0 && servo_->mFailures >= mQuarantineThreshold && !servo_->mQuarantined)
+    {
+        LOG_WARN("Servo ID %d did not answer %d times and is quarantined", (int)servo_->mID,
+                (int)servo_->mFailures);
+        servo_->mQuarantined = true;
+        servo_->mNextProbe = base::Time::now() + mProbeInterval;
+    }
+}
+
+void Dynamixel::recordAnswers(DX_UINT8 const* ids_, int const count_, std::vector<DX_UINT8> const& answered_)
+{
+    for(int i=0; i<count_; i++)
+    {
+        Servo* servo = findServo(ids_[i]);
+        if(std::find(answered_.begin(), answered_.end(), ids_[i]) != answered_.end())
+        {
+            recordTransaction(servo, true);
+        }
+        else
+        {
+            recordTransaction(servo, false);
+            break;
         }
-        return true;
-    } catch(iodrivers_base::UnixError& e) {
-        LOG_ERROR("UnixError catched: %s", e.what());
-    } catch(iodrivers_base::TimeoutError& e) {
-        LOG_ERROR("TimeoutError catched: %s", e.what());
     }
-    } // for loop
-    return false;
 }
 
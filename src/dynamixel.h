@@ -20,11 +20,17 @@
 
 #include <inttypes.h>
 
-#include <map>
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "dynamixel_control_table.h"
 #include "dynamixel_iodriver.h"
+#include "dynamixel_packet.hpp"
+#include "dynamixel_registers.hpp"
+#include "dynamixel_state.h"
+#include "dynamixel_status.h"
 #include "dynamixel_types.hpp"
 
 #define DISALLOW_COPY_AND_ASSIGN(TypeName) \
@@ -40,35 +46,18 @@ class Dynamixel
  public:
     static DX_UINT8 const cCommandBufferSize = 255;
     static int const cBufferSize = 512;
+    /** Size of the transmit batch arena, see openBatch(). */
+    static int const cBatchBufferSize = 2048;
+    /** Number of entries of the default (DX series) control table. */
     static int const cControlTableEntriesNumber = 34;
+    /** Servos are addressed by their ID, 0 up to DX_BROADCAST. */
+    static int const cServoTableSize = DX_BROADCAST + 1;
 
-    /**
-     * \struct ControlTableEntry
-     * Every control table entry of the dynamixel is represented by a object of this struct.
-     * It contains the address, the name, the number of bytes (one or two) and the current value
-     * (if already set or requested, otherwise -1).
-     */
-    struct ControlTableEntry
-    {
-        ControlTableEntry()
-        {
-            mAddress = -1;
-            mName = "";
-            mBytes = -1;
-            mNumber = -1;
-        }
-        ControlTableEntry(int adress_, std::string name_, int bytes_, int number_)
-        {
-            mAddress = adress_;
-            mName = name_;
-            mBytes = bytes_;
-            mNumber = number_;
-        }
-        int mAddress;
-        std::string mName;
-        int mBytes;
-        int mNumber;
-    };
+    /** Identifies a control table entry by its number (ControlTableEntry::mNumber). */
+    typedef int RegisterId;
+
+    /** See dynamixel_control_table.h. */
+    typedef ::ControlTableEntry ControlTableEntry;
 
     /**
      * Represents a single servo.
@@ -78,16 +67,132 @@ class Dynamixel
         Servo(DX_UINT8 id_)
         {
             mID = id_;
-            for(int i=0; i<cControlTableEntriesNumber; i++)
+            mIndex = 0;
+            mModel = NULL;
+            mControlTable = &ControlTable::getDefault();
+            for(int i=0; i<ControlTable::cMaxEntries; i++)
             {
                 mControlTableValues[i]=0;
+                mConfirmedValues[i]=0;
+                mKnown[i]=false;
+                mDirty[i]=false;
             }
+            mPresentValues2.presentCurrent = 0;
+            mPresentValues2.presentVelocity = 0;
+            mPresentValues2.presentPosition = 0;
+            mFailures = 0;
+            mQuarantined = false;
         }   
         DX_UINT8 mID;
+        /** Index of the servo within the arrays of the state store, see getState(). */
+        int mIndex;
+        /** Model of the servo, NULL until getModel() succeeded. */
+        servo_dynamixel::ModelInfo const* mModel;
+        /** Control table layout of the model, the default layout until getModel() succeeded. */
+        ControlTable const* mControlTable;
         servo_dynamixel::ErrorStatus status;
-        uint16_t mControlTableValues[cControlTableEntriesNumber];
+        uint16_t mControlTableValues[ControlTable::cMaxEntries];
+        /** Last control table values read from or written to the servo, unlike
+         *  mControlTableValues without the cached writes, see getConfirmedValue(). */
+        uint16_t mConfirmedValues[ControlTable::cMaxEntries];
+        /** True if the control table value has been read from or written to the servo. */
+        bool mKnown[ControlTable::cMaxEntries];
+        /** True if the control table value has been set but not yet written, see flush(). */
+        bool mDirty[ControlTable::cMaxEntries];
+        /** Present values of Protocol 2.0 servos, see syncReadPresent(). */
+        Dx2PresentValues mPresentValues2;
+        /** Number of consecutive unanswered transactions, see setQuarantineThreshold(). */
+        unsigned int mFailures;
+        /** True if the servo is skipped until a PING is answered. */
+        bool mQuarantined;
+        /** Time of the next PING of a quarantined servo. */
+        base::Time mNextProbe;
     };
     
+    /**
+     * Result of transact().
+     */
+    enum TransactionResult
+    {
+        TRANSACTION_OK = 0,         ///status packet received or none expected
+        TRANSACTION_WRITE_FAILED,   ///the instruction packet could not be written
+        TRANSACTION_TIMEOUT,        ///no status packet within the answer timeout
+        TRANSACTION_IO_ERROR,       ///the serial port reported an error
+        TRANSACTION_INVALID_PACKET  ///the status packet has a wrong checksum
+    };
+
+    /**
+     * Retry handling of writeCommandReadAnswer(), see setRetryPolicy().
+     * The TransactionResult decides the action: a timeout or a broken answer is retried
+     * after a backoff, which starts at \a mBackoff and doubles with every retry up to
+     * \a mMaxBackoff. A failed write is retried at once, since the bus has not been used.
+     * An I/O error of the port is not retried. A late or broken answer cannot be
+     * taken for the answer of the retry: transact() discards the received bytes before
+     * every request and only accepts the answer of the addressed servo.
+     */
+    struct RetryPolicy
+    {
+        RetryPolicy()
+        {
+            mReadRetries = 0;
+            mWriteRetries = 0;
+            mBackoff = base::Time::fromMilliseconds(1);
+            mMaxBackoff = base::Time::fromMilliseconds(16);
+        }
+        /** Retries of READ and PING instructions. */
+        unsigned int mReadRetries;
+        /** Retries of all other instructions. Writes of a servo with a pending REG_WRITE
+         *  are not idempotent, so this limit may be chosen lower than mReadRetries. */
+        unsigned int mWriteRetries;
+        base::Time mBackoff;
+        base::Time mMaxBackoff;
+    };
+
+    /**
+     * Statistics of writeCommandReadAnswer(), see getTransactionCounters().
+     */
+    struct TransactionCounters
+    {
+        static int const cResults = TRANSACTION_INVALID_PACKET + 1;
+
+        TransactionCounters()
+        {
+            for(int i=0; i<cResults; i++)
+            {
+                mCount[i] = 0;
+            }
+            mRetries = 0;
+        }
+        /** Number of attempts by TransactionResult. */
+        unsigned int mCount[cResults];
+        /** Time spent in the attempts by TransactionResult. */
+        base::Time mTime[cResults];
+        unsigned int mRetries;
+    };
+
+    /**
+     * A register read used by readPipelined().
+     */
+    struct ReadRequest
+    {
+        ReadRequest(DX_UINT8 id_, DX_UINT8 address_, DX_UINT8 bytes_, int timeout_ = 0)
+        {
+            mID = id_;
+            mAddress = address_;
+            mBytes = bytes_;
+            mTimeout = timeout_;
+            mDone = false;
+        }
+        DX_UINT8 mID;
+        DX_UINT8 mAddress;
+        DX_UINT8 mBytes;
+        /** Time in ms to wait for the answer after sending the request, 0 derives it from the
+         *  wire time of the window, see DynamixelIODriver::getAnswerTimeout(). */
+        int mTimeout;
+        /** Set to true if the answer has been received. */
+        bool mDone;
+    };
+
     Dynamixel();
 
     /**
@@ -103,57 +208,331 @@ class Dynamixel
      * \param item_name 
      * \param value_ 
      * Fills \a value_ with the value of the passed control table entry (\a item_name).
-     * Updates \a mControlTableEntries.
+     * Updates the control table values of the active servo.
      */
     bool getControlTableEntry(std::string const item_name, uint16_t * const value_);
 
+    /**
+     * Like getControlTableEntry(), but addresses the servo \a id_ directly.
+     */
+    bool getControlTableEntry(DX_UINT8 const id_, std::string const item_name, uint16_t * const value_);
+
+    /**
+     * Writes all control table values which have been set in write cache mode
+     * (see setWriteCache()) to the servos. Contiguous dirty entries of a servo are
+     * merged into a single WRITE packet.
+     * \return false if at least one write failed, the failed entries stay dirty.
+     */
+    bool flush();
+
+    /**
+     * Reads the control table entry \a Reg (e.g. dx::PresentLoad) of the active servo.
+     * Address and size are resolved at compile time, no name lookup is required.
+     */
+    template <class Reg>
+    bool get(uint16_t * const value_)
+    {
+        return checkActiveServo() && readEntry(mActiveServoID, Reg::number, Reg::address, Reg::bytes, value_);
+    }
+
+    /**
+     * Reads the control table entry \a Reg of the servo \a id_.
+     */
+    template <class Reg>
+    bool get(DX_UINT8 const id_, uint16_t * const value_)
+    {
+        return readEntry(id_, Reg::number, Reg::address, Reg::bytes, value_);
+    }
+
+    /**
+     * Sets the control table entry \a Reg (e.g. dx::GoalPosition) of the active servo,
+     * see setControlTableEntry().
+     */
+    template <class Reg>
+    bool set(uint16_t const value_)
+    {
+        return checkActiveServo() && writeEntry(mActiveServoID, Reg::number, Reg::address, Reg::bytes, value_);
+    }
+
+    /**
+     * Sets the control table entry \a Reg of the servo \a id_.
+     */
+    template <class Reg>
+    bool set(DX_UINT8 const id_, uint16_t const value_)
+    {
+        return writeEntry(id_, Reg::number, Reg::address, Reg::bytes, value_);
+    }
+
     /**
      * Builds and returns a string of all control table names and values.
      * Use readControlTable() first.
      */
     std::string getControlTableString();
 
+    /**
+     * Like getControlTableString(), but for the servo \a id_.
+     */
+    std::string getControlTableString(DX_UINT8 const id_);
+
     /**
      * Fills \a pos_ with the current servo position.
      * Faster than getControlTableEntry("Present Position", &value).
      */
     bool getPresentPosition(uint16_t * const pos_);
 
+    /**
+     * Fills \a pos_ with the current position of the servo \a id_.
+     */
+    bool getPresentPosition(DX_UINT8 const id_, uint16_t * const pos_);
+
+    /**
+     * Reads present position, speed, load, voltage and temperature of the servo \a id_
+     * with a single READ and updates its control table values.
+     */
+    bool readPresentValues(DX_UINT8 const id_, DxPresentValues& values_);
+
+    /**
+     * Returns the model of the servo \a id_, read from its Model Number register
+     * on the first call. NULL if the servo could not be read or the model is unknown.
+     * Can be used to set the scales of the servo configuration on mixed-model buses.
+     */
+    servo_dynamixel::ModelInfo const* getModel(DX_UINT8 const id_);
+
+    /**
+     * Reads present position, speed, load, voltage and temperature of all added servos
+     * with a single BULK_READ packet (MX series) and updates their control table values
+     * and error status.
+     * \return false if not all servos answered.
+     */
+    bool bulkReadPresent();
+
+    /**
+     * Reads present current, velocity and position of all added Protocol 2.0 servos with
+     * one SYNC_READ packet and decodes the status packets directly into \a mPresentValues2
+     * and the error status of the servos. With \a fast_ FAST_SYNC_READ is used instead,
+     * so all servos answer within a single concatenated status packet, a block whose crc
+     * is invalid is skipped.
+     * iodrivers_base only hands out packets copied to a caller buffer, so \a mBuffer is the
+     * receive buffer: the packets are unstuffed in place and decoded from there, a fast
+     * sync read checks the crcs of the blocks within the same pass.
+     * Requires DynamixelIODriver::PROTOCOL_2, see setProtocol().
+     * \return false if not all servos answered.
+     */
+    bool syncReadPresent(bool const fast_ = false);
+
+    /**
+     * Sends the READ instruction packets of up to \a mPipelineDepth requests back to back
+     * and assigns the returning status packets to the requests by the servo ID, so the
+     * serial latency is paid once per window instead of once per request. The received
+     * data updates the control table values and the error status of the servos.
+     * A window never contains two requests for the same servo.
+     * @warning The servos answer after their Return Delay Time. All packets of a window
+     *          have to be transmitted within that time, otherwise the answers collide with
+     *          the remaining instruction packets on the half duplex bus. Choose the depth
+     *          (setPipelineDepth()) according to the baud rate and the Return Delay Time.
+     * \return true if all requests have been answered, see ReadRequest::mDone.
+     */
+    bool readPipelined(std::vector<ReadRequest>& requests_);
+
     /**
      * Initialise the Dynamixel object.
      */
     bool init(std::string const & uri);
 
     /**
-     * Reads the complete control table and updates the array \a mControlTableEntries.
+     * Reads the complete control table and updates the control table values of the active servo.
      * Use \a getControlTableString() to generate a string of the struct.
      */
     bool readControlTable();
 
+    /**
+     * Reads the complete control table of the servo \a id_.
+     */
+    bool readControlTable(DX_UINT8 const id_);
+
+    /**
+     * Reads the control table entries \a registers_ of the active servo with as few
+     * READ packets as possible: the entries are sorted by address and merged into
+     * contiguous ranges, gaps up to the read gap tolerance (see setReadGapTolerance())
+     * are read as well. Updates the control table values of the active servo.
+     */
+    bool readRegisters(std::vector<RegisterId> const& registers_);
+
+    /**
+     * Like readRegisters(), but for the servo \a id_.
+     */
+    bool readRegisters(DX_UINT8 const id_, std::vector<RegisterId> const& registers_);
+
     /**
      * Sets the control table entry with the name \a item_name to \a value_.
-     * If successfull \a mControlTableEntries is updated.
-     * @warning only works with little endian architectures!         
+     * If successfull the control table values of the active servo are updated.
+     * In write cache mode the value is only stored and written by flush(),
+     * values which equal the known servo value are skipped.
      */
     bool setControlTableEntry(std::string item_name, uint16_t const value_);
 
+    /**
+     * Like setControlTableEntry(), but addresses the servo \a id_ directly.
+     */
+    bool setControlTableEntry(DX_UINT8 const id_, std::string item_name, uint16_t const value_);
+
     /**
      * Moves the servo to \a pos_. \n
      * Faster than setControlTableEntry("Goal Position" value).
-     * @warning only works with little endian architectures!
+     * In write cache mode the position is written by flush().
      */
     bool setGoalPosition(uint16_t const pos_);
+
+    /**
+     * Moves the servo \a id_ to \a pos_.
+     */
+    bool setGoalPosition(DX_UINT8 const id_, uint16_t const pos_);
+
+    /**
+     * Writes goal position, moving speed and torque limit of the servo \a id_
+     * with a single WRITE and updates its control table values.
+     */
+    bool setMovement(DX_UINT8 const id_, DxMovement const& movement_);
+
+    /**
+     * Writes \a length_ (1 or 2) bytes starting at \a address_ to all servos in \a ids_
+     * with a single SYNC_WRITE broadcast packet, \a values_[i] is written to \a ids_[i].
+     * No status packets are returned, so the error status of the servos is not updated.
+     * The control table values of added servos are updated.
+     */
+    bool syncWrite(DX_UINT8 const address_, DX_UINT8 const length_,
+            std::vector<DX_UINT8> const& ids_, std::vector<uint16_t> const& values_);
+
+    /**
+     * Moves the servos \a ids_ to \a positions_ using one SYNC_WRITE packet.
+     * Does not wait for status packets, see syncWrite().
+     */
+    bool setGoalPositions(std::vector<DX_UINT8> const& ids_, std::vector<uint16_t> const& positions_);
+
+    /**
+     * Returns the Status Return Level of the servo \a id_ (DX_NO_RESPONE, DX_READ_ONLY
+     * or DX_FULL_RESPONSE). DX_FULL_RESPONSE is assumed until the level has been read
+     * or written. Instructions which are not answered according to the level return
+     * right after they have been sent instead of waiting for the timeout.
+     */
+    DX_UINT8 getStatusReturnLevel(DX_UINT8 const id_);
+
+    /**
+     * Sets the Status Return Level of all servos with one broadcast WRITE, e.g.
+     * DX_READ_ONLY to halve the bus time of writes.
+     */
+    bool setStatusReturnLevel(DX_UINT8 const level_);
+
+    /**
+     * Sends the Protocol 1.0 instruction packet \a command_ and waits for the status
+     * packet, if the servo answers it (see getStatusReturnLevel()). Timeouts and serial
+     * errors are returned instead of thrown, nothing is retried or logged, so polling
+     * missing servos stays cheap. \a error_flags_ receives the error bits of the status
+     * packet (0 if none is expected), the packet itself is returned by getLastStatus().
+     */
+    TransactionResult transact(DX_UINT8 const* command_, int const command_length_, DX_UINT8& error_flags_);
+
+    /**
+     * The status packet received by the last successful transact().
+     */
+    inline StatusPacket getLastStatus() const
+    {
+        return StatusPacket(mBuffer, mLastStatusSize);
+    }
+
+    /**
+     * Opens a transmit batch: the batch functions below only stage their instruction
+     * packets, commitBatch() sends all of them with a single write. A batch which
+     * has not been committed is discarded.
+     * The bus is half duplex and a servo answers after its Return Delay Time, while
+     * the following packets are still being sent. Hence only packets which are not
+     * answered can be staged: broadcasts, and WRITE/REG_WRITE to servos with the
+     * Status Return Level DX_READ_ONLY or lower (see setStatusReturnLevel()).
+     */
+    void openBatch();
+
+    /**
+     * Stages a WRITE of \a value_ to the control table entry \a Reg of the servo \a id_.
+     */
+    template <class Reg>
+    bool batchWrite(DX_UINT8 const id_, uint16_t const value_)
+    {
+        return addWriteToBatch(id_, DX_WRITE, Reg::number, Reg::address, Reg::bytes, value_);
+    }
+
+    /**
+     * Stages a REG_WRITE of \a value_ to the control table entry \a Reg of the servo \a id_,
+     * executed by the next ACTION, see batchAction().
+     */
+    template <class Reg>
+    bool batchRegWrite(DX_UINT8 const id_, uint16_t const value_)
+    {
+        return addWriteToBatch(id_, DX_REGWRITE, Reg::number, Reg::address, Reg::bytes, value_);
+    }
+
+    /**
+     * Stages a broadcast ACTION, all servos execute their registered writes.
+     */
+    bool batchAction();
+
+    /**
+     * Stages the encoded Protocol 1.0 instruction packet \a packet_ of \a size_ bytes.
+     * Returns false if the addressed servo would answer it, see openBatch().
+     */
+    bool addToBatch(DX_UINT8 const* packet_, int const size_);
+
+    /**
+     * Sends all staged packets with a single write. The values of staged WRITEs
+     * are stored once the batch has been sent. Returns false if the batch could
+     * not be sent.
+     */
+    bool commitBatch();
+
+    /**
+     * Stages the movement (goal position, moving speed and torque limit) of the
+     * servo \a id_, see triggerMovements(). A staged movement of the same servo is replaced.
+     */
+    bool stageMovement(DX_UINT8 const id_, DxMovement const& movement_);
+
+    /**
+     * Registers the staged movements with one REG_WRITE per servo and starts all of
+     * them with a single broadcast ACTION, so the servos start moving at the same time.
+     * If a movement could not be registered or the ACTION could not be sent, false
+     * is returned and the movements already registered, including the failed one whose
+     * answer may have been lost, are overwritten with the known control table values
+     * of the servos, see unregisterMovements().
+     * @warning A servo whose goal position, moving speed or torque limit is unknown
+     *          (never read or written) keeps its registered movement in that case,
+     *          the next ACTION of any sender starts it.
+     * The staged movements are cleared in all cases.
+     */
+    bool triggerMovements();
+
+    /**
+     * Discards the staged movements.
+     */
+    void clearMovements();
     
     /** 
      * @brief return true if the error status of the dynamixel is ok
      */
     bool isErrorStatusOk();
 
+    /**
+     * @brief return true if the error status of the servo \a id_ is ok
+     */
+    bool isErrorStatusOk(DX_UINT8 const id_);
+
     /**
      * @return the error status of the active servo
      */
     servo_dynamixel::ErrorStatus getErrorStatus();
 
+    /**
+     * @return the error status of the servo \a id_
+     */
+    servo_dynamixel::ErrorStatus getErrorStatus(DX_UINT8 const id_);
+
     void clear()
     {
         return mpDynamixelIODriver->clear();
@@ -171,62 +550,369 @@ class Dynamixel
         mpDynamixelIODriver->setTimeout(timeout_);
     }
 
+    /**
+     * Safety margin in us added to the wire time of a transaction, see
+     * DynamixelIODriver::setTimeoutMargin(). The serial timeout stays the upper limit.
+     */
+    inline void setTimeoutMargin(int const margin_us_)
+    {
+        mpDynamixelIODriver->setTimeoutMargin(margin_us_);
+    }
+
+    /**
+     * Selects the protocol used to frame the received status packets, see
+     * DynamixelIODriver::setProtocol(). The control table functions of this class
+     * use Protocol 1.0 packets.
+     */
+    inline void setProtocol(DynamixelIODriver::Protocol const protocol_)
+    {
+        mpDynamixelIODriver->setProtocol(protocol_);
+    }
+
     Servo* setServoActive(unsigned char id_);
 
     inline unsigned char getActiveServo() {
         return mActiveServoID;
     }
     
+    /**
+     * Sets the read and the write retries of the retry policy to \a num.
+     */
     inline void setNumberRetries(unsigned int num){
-        mNumberRetries = num;
+        mRetryPolicy.mReadRetries = num;
+        mRetryPolicy.mWriteRetries = num;
+    }
+
+    inline void setRetryPolicy(RetryPolicy const& policy){
+        mRetryPolicy = policy;
+    }
+
+    inline RetryPolicy const& getRetryPolicy() const {
+        return mRetryPolicy;
+    }
+
+    /**
+     * Returns the attempts and retries of the transactions so far,
+     * e.g. to see how much bus time is lost by timeouts.
+     */
+    inline TransactionCounters const& getTransactionCounters() const {
+        return mTransactionCounters;
+    }
+
+    inline void resetTransactionCounters(){
+        mTransactionCounters = TransactionCounters();
     }
 
+    /**
+     * Enables the write cache mode: setControlTableEntry() and setGoalPosition() only
+     * mark the values as dirty, flush() writes them. Disabled by default, call flush()
+     * before disabling it.
+     */
+    inline void setWriteCache(bool enable){
+        mWriteCache = enable;
+    }
+
+    /**
+     * Number of unrequested bytes readRegisters() may read to merge two ranges, default 8.
+     * Reading a byte takes much less time than an additional transaction.
+     */
+    inline void setReadGapTolerance(unsigned int bytes){
+        mReadGapTolerance = bytes;
+    }
+
+    /**
+     * Maximal number of requests which are sent back to back by readPipelined(), default 4.
+     */
+    inline void setPipelineDepth(unsigned int depth){
+        mPipelineDepth = depth;
+    }
+
+    /**
+     * Number of consecutive unanswered transactions after which a servo is quarantined,
+     * default 3, 0 disables the quarantine. Transactions with a quarantined servo fail
+     * immediately and batched and pipelined reads skip it, so a servo which dropped off
+     * the bus does not use up the bus time of the others. It is probed with a PING every
+     * probe interval (see setProbeInterval()) and reinstated once it answers.
+     */
+    inline void setQuarantineThreshold(unsigned int failures){
+        mQuarantineThreshold = failures;
+    }
+
+    /**
+     * Time in ms between two PINGs of a quarantined servo, default 500.
+     */
+    inline void setProbeInterval(unsigned int interval){
+        mProbeInterval = base::Time::fromMilliseconds(interval);
+    }
+
+    /**
+     * True if the servo \a id_ is quarantined, see setQuarantineThreshold().
+     */
+    bool isQuarantined(DX_UINT8 const id_);
+
     /**
      * Allows to request a copy of the control table entry.
      * \param name Name of the control table entry.
      * \param entry Will be set to the requested control table structure.
      * \return false if the control name is unknown.
      */
-    bool getControlTableEntry(std::string const name, struct ControlTableEntry& entry);
+    bool getControlTableEntry(std::string const name, ControlTableEntry& entry);
 
     /**
      * Returns a copy of the list of all added servos.
      */
     std::vector<struct Servo> getServoListCopy();
 
+    /**
+     * Returns the present values and error bits of all servos as contiguous arrays,
+     * ordered like the servos have been added. Unlike getServoListCopy() nothing
+     * is copied, the arrays are updated by every read and write.
+     */
+    inline DynamixelStateStore const& getState() const
+    {
+        return mState;
+    }
+
  private:
     //MEMBER VARIABLES
     DX_UINT8 mCommandBuffer[cCommandBufferSize];
     DX_UINT8 mBuffer[cBufferSize];
+    /** Size of the status packet in mBuffer received by transact(). */
+    int mLastStatusSize;
+
+    /**
+     * A value written by a staged WRITE, stored by commitBatch().
+     */
+    struct BatchValue
+    {
+        DX_UINT8 mID;
+        int mNumber;
+        uint16_t mValue;
+    };
+
+    /** Staged instruction packets of the open transmit batch. */
+    DX_UINT8 mBatchBuffer[cBatchBufferSize];
+    int mBatchSize;
+    bool mBatchOpen;
+    std::vector<BatchValue> mBatchValues;
+
+    /** Movements staged by stageMovement(), in order. */
+    std::vector<std::pair<DX_UINT8, DxMovement> > mStagedMovements;
 
     DynamixelIODriver* mpDynamixelIODriver; ///serial communication
 
     std::vector<struct Servo*> mServoList;
+    /** The added servos indexed by their ID, NULL if not added. */
+    Servo* mServoTable[cServoTableSize];
+    /** Present values of all servos as structure of arrays. */
+    DynamixelStateStore mState;
 
     DX_UINT8 mActiveServoID;
     Servo* mpActiveServo;
 
-    struct ControlTableEntry mControlTableEntries[cControlTableEntriesNumber]; 
-    /** Used in setControlTableEntry and getControlTableEntry. */
-    std::map<std::string, struct ControlTableEntry*> mMapStringCTEntry;
    
    /** 
     * Can be used to resend a command if an error occurred.
     * This is required in our current configuration,  because sometimes
     * one of the start bytes get lost.
     */
-   unsigned int mNumberRetries;
+   RetryPolicy mRetryPolicy;
+   TransactionCounters mTransactionCounters;
+
+   /** Maximal number of outstanding requests of readPipelined(). */
+   unsigned int mPipelineDepth;
+
+   /** Write cache mode, see setWriteCache(). */
+   bool mWriteCache;
+
+   /** Maximal gap in bytes between two merged ranges of readRegisters(). */
+   unsigned int mReadGapTolerance;
+
+   /** Failures until a servo is quarantined, see setQuarantineThreshold(). */
+   unsigned int mQuarantineThreshold;
+   base::Time mProbeInterval;
     
     //FUNCTIONS    
-    void buildControlTable();
+    /**
+     * Reads the control table entry \a number_ of the servo \a id_.
+     */
+    bool readEntry(DX_UINT8 const id_, int const number_, int const address_, int const bytes_, uint16_t * const value_);
+
+    /**
+     * Writes (or caches, see setWriteCache()) the control table entry \a number_ of the servo \a id_.
+     */
+    bool writeEntry(DX_UINT8 const id_, int const number_, int const address_, int const bytes_, uint16_t const value_);
+
+    /**
+     * Returns the added servo with the ID \a id_ or NULL, a lookup in \a mServoTable.
+     */
+    Servo* findServo(DX_UINT8 const id_);
+
+    /**
+     * Returns whether the control table of \a servo_ has the entry \a number_ at
+     * \a address_ with \a bytes_ bytes, e.g. dx::UpCalibration is missing on MX servos.
+     */
+    static bool checkEntry(Servo const* servo_, int const number_, int const address_, int const bytes_);
+
+    /**
+     * Returns true if an active servo is set, logs a warning otherwise.
+     */
+    bool checkActiveServo();
+
+    /**
+     * Returns the name of the control table entry \a number_ of the model of \a servo_.
+     */
+    static char const* getEntryName(Servo* servo_, int const number_);
+
+    /**
+     * Decodes the parameters of \a status_, read starting at \a address_, into
+     * the control table values of \a servo_. Only entries which are completely
+     * contained in the parameters are updated, see storeReadValue().
+     */
+    void setControlTableValues(Servo* servo_, StatusPacket const& status_, int const address_);
+
+    /**
+     * Stores the value \a value_ of the control table entry \a number_ read from \a servo_.
+     * Dirty entries keep their value until they are flushed.
+     */
+    void storeReadValue(Servo* servo_, int const number_, uint16_t const value_);
+
+    /**
+     * Stores the value \a value_ of the control table entry \a number_ written to \a servo_.
+     */
+    void storeWrittenValue(Servo* servo_, int const number_, uint16_t const value_);
+
+    /**
+     * Stores \a value_ as dirty value of the control table entry \a number_ of \a servo_
+     * (write cache mode), unless it equals the known value.
+     */
+    void cacheValue(Servo* servo_, int const number_, uint16_t const value_);
+
+    /**
+     * Stores the value of the control table entry \a number_ the servo has, which differs
+     * from the cached value while it is dirty, to \a value_.
+     * \return false if the value has never been read from or written to the servo.
+     */
+    bool getConfirmedValue(Servo const* servo_, int const number_, uint16_t& value_) const;
+
+    /**
+     * Updates the status of \a servo_ using the error flags of the status packet in \a mBuffer.
+     */
+    void updateErrorStatus(Servo* servo_);
+
+    /**
+     * Updates the status of \a servo_ using the error byte \a error_ of a Protocol 2.0 status packet.
+     */
+    void updateErrorStatus2(Servo* servo_, DX_UINT8 const error_);
+
+    /**
+     * Decodes the DX2_PRESENT_VALUES_SIZE bytes of present values \a data_ (little endian,
+     * read from DX2_PRESENT_CURRENT) into \a mPresentValues2 of \a servo_ and the state store.
+     */
+    void setPresentValues2(Servo* servo_, DX_UINT8 const* data_);
+
+    /**
+     * Writes the command in \a mCommandBuffer without waiting for a status packet.
+     */
+    bool writeCommand(int command_length_bytes);
+
+    /**
+     * Writes the request in \a mCommandBuffer like writeCommand(), the answers are
+     * read afterwards. Received bytes belong to earlier requests and are discarded
+     * first, see DynamixelIODriver::clear().
+     */
+    bool writeRequest(int command_length_bytes);
+
+    /**
+     * Writes \a size_ bytes of \a buffer_, retried like writeCommand().
+     */
+    bool writeBuffer(DX_UINT8 const* buffer_, int const size_);
+
+    /**
+     * Stages a WRITE or REG_WRITE (\a instruction_) of the control table entry \a number_.
+     */
+    bool addWriteToBatch(DX_UINT8 const id_, DX_UINT8 const instruction_, int const number_,
+            int const address_, int const bytes_, uint16_t const value_);
+
+    /**
+     * Encodes a WRITE or REG_WRITE (\a instruction_) of \a movement_ into the command buffer,
+     * returns the command length.
+     */
+    int encodeMovement(DX_UINT8 const id_, DX_UINT8 const instruction_, DxMovement const& movement_);
+
+    /**
+     * Stores the written \a movement_ to the control table values of \a servo_.
+     */
+    void storeMovement(Servo* servo_, DxMovement const& movement_);
+
+    /**
+     * Overwrites the REG_WRITEs of the first \a count_ \a movements_, which have been
+     * registered but not started, with the known goal position, moving speed and
+     * torque limit of the servos, so a later ACTION does not start them.
+     */
+    void unregisterMovements(std::vector<std::pair<DX_UINT8, DxMovement> > const& movements_,
+            unsigned int const count_);
 
     /**
      * First write the command to the \a mCommandBuffer.
+     * No status packet is awaited if the command is sent to DX_BROADCAST or the
+     * Status Return Level suppresses it. READ and PING fail in that case, since
+     * only the status packet carries their result.
      * \param command_length_bytes Length of the command.
+     * \param servo_ Addressed servo, its status is updated by the status packet.
      * \return True if the command could be sent and the received
      *         status packet is error free.
      */
-    bool writeCommandReadAnswer(int command_length_bytes, servo_dynamixel::ErrorStatus &status);
+    bool writeCommandReadAnswer(int command_length_bytes, Servo* servo_);
+
+    /**
+     * True if the addressed servo answers the Protocol 1.0 instruction packet \a command_,
+     * see getStatusReturnLevel(). A write of the Status Return Level is answered
+     * according to the written level.
+     */
+    bool expectsStatusPacket(DX_UINT8 const* command_);
+
+    /**
+     * Waits before the retry \a retry_ (1 for the first), see RetryPolicy.
+     */
+    void retryBackoff(unsigned int const retry_);
+
+    /**
+     * False if \a servo_ is quarantined. A due PING is sent first, see setProbeInterval().
+     */
+    bool isAvailable(Servo* servo_);
+
+    /**
+     * Counts an answered (\a answered_) or unanswered transaction with \a servo_,
+     * quarantines or reinstates the servo.
+     */
+    void recordTransaction(Servo* servo_, bool const answered_);
+
+    /**
+     * Records the answers of a batched read of the \a count_ servos \a ids_, which answer
+     * one after another: the servos \a answered_ were successful, the first missing one
+     * failed. The servos behind it could not answer and are not counted.
+     */
+    void recordAnswers(DX_UINT8 const* ids_, int const count_, std::vector<DX_UINT8> const& answered_);
+
+    /**
+     * Returns the time to wait for the status packet answering the Protocol 1.0
+     * instruction packet \a command_ of \a command_length_bytes, derived from the
+     * baud rate, the packet sizes and the Return Delay Time of the servo.
+     */
+    base::Time getAnswerTimeout(DX_UINT8 const* command_, int command_length_bytes);
+
+    /**
+     * Returns the Return Delay Time of the servo \a id_, the factory default of 500 us
+     * if it is not known.
+     */
+    base::Time getReturnDelay(DX_UINT8 const id_);
+
+    /**
+     * Reads a packet into mBuffer, waiting up to \a deadline_. Throws like
+     * DynamixelIODriver::readPacket().
+     */
+    int readPacketUntil(base::Time const& deadline_);
 
     DISALLOW_COPY_AND_ASSIGN(Dynamixel);
 };
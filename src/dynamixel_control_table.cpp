@@ -0,0 +1,278 @@
+#include "dynamixel_control_table.h"
+
+#include "dynamixel_models.hpp"
+#include "dynamixel_registers.hpp"
+
+namespace {
+
+//------------------------------------------------------------------------------------------------------
+// control table layouts, see ControlTableDescriptor
+
+// row of the entry described by dx::reg, so number, address and size are defined once
+#define ROW(reg, name) { dx::reg::number, dx::reg::address, dx::reg::bytes, name }
+
+// DX, AX and RX series
+ControlTableDescriptor const cDxTable[] =
+{
+    ROW(ModelNumber, "Model Number"),
+    ROW(FirmwareVersion, "Version of Firmware"),
+    ROW(ID, "ID"),
+    ROW(BaudRate, "Baud Rate"),
+    ROW(ReturnDelayTime, "Return Delay Time"),
+    ROW(CWAngleLimit, "CW Angle Limit"),
+    ROW(CCWAngleLimit, "CCW Angle Limit"),
+    ROW(HighestLimitTemperature, "the Highest Limit Temperature"),
+    ROW(LowestLimitVoltage, "the Lowest Limit Voltage"),
+    ROW(HighestLimitVoltage, "the Highest Limit Voltage"),
+    ROW(MaxTorque, "Max Torque"),
+    ROW(StatusReturnLevel, "Status Return Level"),
+    ROW(AlarmLED, "Alarm LED"),
+    ROW(AlarmShutdown, "Alarm Shutdown"),
+    ROW(DownCalibration, "Down Calibration"),
+    ROW(UpCalibration, "Up Calibration"),
+    ROW(TorqueEnable, "Torque Enable"),
+    ROW(LED, "LED"),
+    ROW(CWComplianceMargin, "CW Compliance Margin"),
+    ROW(CCWComplianceMargin, "CCW Compliance Margin"),
+    ROW(CWComplianceSlope, "CW Compliance Slope"),
+    ROW(CCWComplianceSlope, "CCW Compliance Slope"),
+    ROW(GoalPosition, "Goal Position"),
+    ROW(MovingSpeed, "Moving Speed"),
+    ROW(TorqueLimit, "Torque Limit"),
+    ROW(PresentPosition, "Present Position"),
+    ROW(PresentSpeed, "Present Speed"),
+    ROW(PresentLoad, "Present Load"),
+    ROW(PresentVoltage, "Present Voltage"),
+    ROW(PresentTemperature, "Present Temperature"),
+    ROW(RegisteredInstruction, "Registered Instruction"),
+    ROW(Moving, "Moving"),
+    ROW(Lock, "Lock"),
+    ROW(Punch, "Punch")
+};
+
+// MX-28: multi turn instead of calibration, PID gains instead of compliance
+ControlTableDescriptor const cMx28Table[] =
+{
+    ROW(ModelNumber, "Model Number"),
+    ROW(FirmwareVersion, "Version of Firmware"),
+    ROW(ID, "ID"),
+    ROW(BaudRate, "Baud Rate"),
+    ROW(ReturnDelayTime, "Return Delay Time"),
+    ROW(CWAngleLimit, "CW Angle Limit"),
+    ROW(CCWAngleLimit, "CCW Angle Limit"),
+    ROW(HighestLimitTemperature, "the Highest Limit Temperature"),
+    ROW(LowestLimitVoltage, "the Lowest Limit Voltage"),
+    ROW(HighestLimitVoltage, "the Highest Limit Voltage"),
+    ROW(MaxTorque, "Max Torque"),
+    ROW(StatusReturnLevel, "Status Return Level"),
+    ROW(AlarmLED, "Alarm LED"),
+    ROW(AlarmShutdown, "Alarm Shutdown"),
+    ROW(MultiTurnOffset, "Multi Turn Offset"),
+    ROW(ResolutionDivider, "Resolution Divider"),
+    ROW(TorqueEnable, "Torque Enable"),
+    ROW(LED, "LED"),
+    ROW(DGain, "D Gain"),
+    ROW(IGain, "I Gain"),
+    ROW(PGain, "P Gain"),
+    ROW(GoalPosition, "Goal Position"),
+    ROW(MovingSpeed, "Moving Speed"),
+    ROW(TorqueLimit, "Torque Limit"),
+    ROW(PresentPosition, "Present Position"),
+    ROW(PresentSpeed, "Present Speed"),
+    ROW(PresentLoad, "Present Load"),
+    ROW(PresentVoltage, "Present Voltage"),
+    ROW(PresentTemperature, "Present Temperature"),
+    ROW(RegisteredInstruction, "Registered Instruction"),
+    ROW(Moving, "Moving"),
+    ROW(Lock, "Lock"),
+    ROW(Punch, "Punch"),
+    ROW(GoalAcceleration, "Goal Acceleration")
+};
+
+// MX-64 and MX-106: MX-28 and current based torque control
+ControlTableDescriptor const cMx64Table[] =
+{
+    ROW(ModelNumber, "Model Number"),
+    ROW(FirmwareVersion, "Version of Firmware"),
+    ROW(ID, "ID"),
+    ROW(BaudRate, "Baud Rate"),
+    ROW(ReturnDelayTime, "Return Delay Time"),
+    ROW(CWAngleLimit, "CW Angle Limit"),
+    ROW(CCWAngleLimit, "CCW Angle Limit"),
+    ROW(HighestLimitTemperature, "the Highest Limit Temperature"),
+    ROW(LowestLimitVoltage, "the Lowest Limit Voltage"),
+    ROW(HighestLimitVoltage, "the Highest Limit Voltage"),
+    ROW(MaxTorque, "Max Torque"),
+    ROW(StatusReturnLevel, "Status Return Level"),
+    ROW(AlarmLED, "Alarm LED"),
+    ROW(AlarmShutdown, "Alarm Shutdown"),
+    ROW(MultiTurnOffset, "Multi Turn Offset"),
+    ROW(ResolutionDivider, "Resolution Divider"),
+    ROW(TorqueEnable, "Torque Enable"),
+    ROW(LED, "LED"),
+    ROW(DGain, "D Gain"),
+    ROW(IGain, "I Gain"),
+    ROW(PGain, "P Gain"),
+    ROW(GoalPosition, "Goal Position"),
+    ROW(MovingSpeed, "Moving Speed"),
+    ROW(TorqueLimit, "Torque Limit"),
+    ROW(PresentPosition, "Present Position"),
+    ROW(PresentSpeed, "Present Speed"),
+    ROW(PresentLoad, "Present Load"),
+    ROW(PresentVoltage, "Present Voltage"),
+    ROW(PresentTemperature, "Present Temperature"),
+    ROW(RegisteredInstruction, "Registered Instruction"),
+    ROW(Moving, "Moving"),
+    ROW(Lock, "Lock"),
+    ROW(Punch, "Punch"),
+    ROW(Current, "Current"),
+    ROW(TorqueControlModeEnable, "Torque Control Mode Enable"),
+    ROW(GoalTorque, "Goal Torque"),
+    ROW(GoalAcceleration, "Goal Acceleration")
+};
+
+#undef ROW
+
+#define TABLE(model, rows) { model, rows, sizeof(rows) / sizeof(rows[0]) }
+
+struct Layout
+{
+    int mModelNumber;
+    ControlTableDescriptor const* mRows;
+    int mCount;
+};
+
+// registry of the layouts, model number 0 is the default
+Layout const cLayouts[] =
+{
+    TABLE(0, cDxTable),
+    TABLE(servo_dynamixel::MODEL_AX_12, cDxTable),
+    TABLE(servo_dynamixel::MODEL_AX_18, cDxTable),
+    TABLE(servo_dynamixel::MODEL_RX_28, cDxTable),
+    TABLE(servo_dynamixel::MODEL_RX_64, cDxTable),
+    TABLE(servo_dynamixel::MODEL_DX_116, cDxTable),
+    TABLE(servo_dynamixel::MODEL_MX_28, cMx28Table),
+    TABLE(servo_dynamixel::MODEL_MX_64, cMx64Table),
+    TABLE(servo_dynamixel::MODEL_MX_106, cMx64Table)
+};
+
+#undef TABLE
+
+int const cLayoutsNumber = sizeof(cLayouts) / sizeof(cLayouts[0]);
+
+std::vector<ControlTable> buildTables()
+{
+    std::vector<ControlTable> tables;
+    for(int i=0; i<cLayoutsNumber; i++)
+    {
+        tables.push_back(ControlTable(cLayouts[i].mModelNumber, cLayouts[i].mRows, cLayouts[i].mCount));
+    }
+    return tables;
+}
+
+} // end anonymous namespace
+
+ControlTable::ControlTable(int const model_number_, ControlTableDescriptor const* rows_, int const count_) :
+        mModelNumber(model_number_), mByNumber(cMaxEntries, -1), mByAddress(cMaxAddress, -1), mNameSeed(0)
+{
+    for(int i=0; i<count_; i++)
+    {
+        mEntries.push_back(ControlTableEntry(rows_[i].mAddress, rows_[i].mName, rows_[i].mBytes, rows_[i].mNumber));
+        mByNumber[rows_[i].mNumber] = i;
+        mByAddress[rows_[i].mAddress] = i;
+    }
+    buildNameIndex();
+}
+
+ControlTable const& ControlTable::get(int const model_number_)
+{
+    static std::vector<ControlTable> const tables = buildTables();
+    for(unsigned int i=0; i<tables.size(); i++)
+    {
+        if(tables[i].mModelNumber == model_number_)
+        {
+            return tables[i];
+        }
+    }
+    return tables[0];
+}
+
+ControlTable const& ControlTable::getDefault()
+{
+    return get(0);
+}
+
+int ControlTable::getLength() const
+{
+    return mEntries.empty() ? 0 : mEntries.back().mAddress + mEntries.back().mBytes;
+}
+
+ControlTableEntry const* ControlTable::findByNumber(int const number_) const
+{
+    if(number_ < 0 || number_ >= cMaxEntries || mByNumber[number_] < 0)
+    {
+        return NULL;
+    }
+    return &mEntries[mByNumber[number_]];
+}
+
+ControlTableEntry const* ControlTable::findByAddress(int const address_) const
+{
+    if(address_ < 0 || address_ >= cMaxAddress || mByAddress[address_] < 0)
+    {
+        return NULL;
+    }
+    return &mEntries[mByAddress[address_]];
+}
+
+ControlTableEntry const* ControlTable::findByName(std::string const& name_) const
+{
+    int index = mNameSlots[hash(name_, mNameSeed) & (mNameSlots.size() - 1)];
+    if(index < 0 || mEntries[index].mName != name_)
+    {
+        return NULL;
+    }
+    return &mEntries[index];
+}
+
+uint32_t ControlTable::hash(std::string const& name_, uint32_t const seed_)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u ^ seed_;
+    for(unsigned int i=0; i<name_.size(); i++)
+    {
+        h = (h ^ (uint8_t)name_[i]) * 16777619u;
+    }
+    return h;
+}
+
+void ControlTable::buildNameIndex()
+{
+    unsigned int slots = 1;
+    while(slots < 2 * mEntries.size())
+    {
+        slots <<= 1;
+    }
+    // a seed without collisions is usually found after a few attempts,
+    // otherwise the table gets larger
+    for(;;)
+    {
+        for(uint32_t seed=0; seed<256; seed++)
+        {
+            mNameSlots.assign(slots, -1);
+            bool collision = false;
+            for(unsigned int i=0; i<mEntries.size() && !collision; i++)
+            {
+                int& slot = mNameSlots[hash(mEntries[i].mName, seed) & (slots - 1)];
+                collision = slot >= 0;
+                slot = i;
+            }
+            if(!collision)
+            {
+                mNameSeed = seed;
+                return;
+            }
+        }
+        slots <<= 1;
+    }
+}
@@ -0,0 +1,154 @@
+/**
+ * \file dynamixel_control_table.h
+ *
+ * \brief   Control table layouts of the supported servo models.
+ *
+ * \details The layouts are plain data (ControlTableDescriptor rows, see
+ *          dynamixel_control_table.cpp) registered by their model number.
+ *          Adding a model only requires adding its rows and one registry line.
+ *          Each layout is built once and shared by all servos of the model.
+ *
+ *          The entry numbers are the numbers of dynamixel_registers.hpp and denote
+ *          the same address and size in every layout. A layout only contains the
+ *          registers of its model, e.g. the MX layouts have dx::DGain (number 40)
+ *          at address 26 instead of dx::CWComplianceMargin (number 18). The typed
+ *          accessors of Dynamixel fail for registers missing in the layout.
+ */
+
+#ifndef DYNAMIXEL_CONTROL_TABLE_H_
+#define DYNAMIXEL_CONTROL_TABLE_H_
+
+#include <inttypes.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * \struct ControlTableEntry
+ * Every control table entry of the dynamixel is represented by a object of this struct.
+ * It contains the address, the name, the number of bytes (one or two) and the
+ * number (index of the value within Dynamixel::Servo).
+ */
+struct ControlTableEntry
+{
+    ControlTableEntry()
+    {
+        mAddress = -1;
+        mName = "";
+        mBytes = -1;
+        mNumber = -1;
+    }
+    ControlTableEntry(int adress_, std::string name_, int bytes_, int number_)
+    {
+        mAddress = adress_;
+        mName = name_;
+        mBytes = bytes_;
+        mNumber = number_;
+    }
+    int mAddress;
+    std::string mName;
+    int mBytes;
+    int mNumber;
+};
+
+/**
+ * One row of a control table layout. The rows have to be ordered by
+ * address.
+ */
+struct ControlTableDescriptor
+{
+    int mNumber;
+    int mAddress;
+    int mBytes;
+    char const* mName;
+};
+
+/**
+ * \class ControlTable
+ * The control table layout of a servo model with O(1) lookups by number,
+ * address and name (perfect hash).
+ */
+class ControlTable
+{
+ public:
+    /** Entry numbers are smaller than this value. */
+    static int const cMaxEntries = 64;
+    /** Addresses of Protocol 1.0 control tables are smaller than this value. */
+    static int const cMaxAddress = 256;
+
+    ControlTable(int const model_number_, ControlTableDescriptor const* rows_, int const count_);
+
+    /**
+     * Returns the layout of the model \a model_number_, the default (DX series)
+     * layout if the model is unknown. Built on the first request.
+     */
+    static ControlTable const& get(int const model_number_);
+
+    /**
+     * Returns the DX series layout, used until the model of a servo is known.
+     */
+    static ControlTable const& getDefault();
+
+    /**
+     * Model number of the layout, 0 for the default layout.
+     */
+    inline int getModelNumber() const
+    {
+        return mModelNumber;
+    }
+
+    /**
+     * Number of entries.
+     */
+    inline int size() const
+    {
+        return mEntries.size();
+    }
+
+    /**
+     * Returns the entry \a i_, the entries are ordered by address.
+     */
+    inline ControlTableEntry const& operator[](int const i_) const
+    {
+        return mEntries[i_];
+    }
+
+    /**
+     * Number of bytes from address 0 up to the end of the last entry.
+     */
+    int getLength() const;
+
+    /**
+     * Returns the entry with the number \a number_ or NULL.
+     */
+    ControlTableEntry const* findByNumber(int const number_) const;
+
+    /**
+     * Returns the entry starting at \a address_ or NULL.
+     */
+    ControlTableEntry const* findByAddress(int const address_) const;
+
+    /**
+     * Returns the entry named \a name_ or NULL.
+     */
+    ControlTableEntry const* findByName(std::string const& name_) const;
+
+ private:
+    static uint32_t hash(std::string const& name_, uint32_t const seed_);
+
+    /**
+     * Searches a seed without collisions for the names, see findByName().
+     */
+    void buildNameIndex();
+
+    int mModelNumber;
+    std::vector<ControlTableEntry> mEntries;
+    /** Index within mEntries by number and by address, -1 if not available. */
+    std::vector<int> mByNumber;
+    std::vector<int> mByAddress;
+    /** Perfect hash of the names: slot -> index within mEntries or -1. */
+    std::vector<int> mNameSlots;
+    uint32_t mNameSeed;
+};
+
+#endif
@@ -0,0 +1,256 @@
+#include "dynamixel_conversion.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace servo_dynamixel {
+
+namespace {
+
+uint16_t const cMagnitudeMask = 0x3FF;
+uint16_t const cDirectionBit = 0x400;
+
+#if defined(__AVX2__)
+inline __m256 loadTicks(uint16_t const* ticks_)
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i const*)ticks_)));
+}
+
+// values have to be clamped to [0, 65535]
+inline void storeTicks(__m256 values_, uint16_t* ticks_)
+{
+    __m256i ticks = _mm256_cvttps_epi32(_mm256_add_ps(values_, _mm256_set1_ps(0.5f)));
+    _mm_storeu_si128((__m128i*)ticks_, _mm_packus_epi32(_mm256_castsi256_si128(ticks),
+            _mm256_extracti128_si256(ticks, 1)));
+}
+#elif defined(__SSE2__)
+inline __m128 loadTicks(uint16_t const* ticks_)
+{
+    __m128i ticks = _mm_loadl_epi64((__m128i const*)ticks_);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(ticks, _mm_setzero_si128()));
+}
+
+// values have to be clamped to [0, 65535], SSE2 only provides a signed pack
+inline void storeTicks(__m128 values_, uint16_t* ticks_)
+{
+    __m128i ticks = _mm_cvttps_epi32(_mm_add_ps(values_, _mm_set1_ps(0.5f)));
+    ticks = _mm_sub_epi32(ticks, _mm_set1_epi32(0x8000));
+    ticks = _mm_add_epi16(_mm_packs_epi32(ticks, ticks), _mm_set1_epi16((short)0x8000));
+    _mm_storel_epi64((__m128i*)ticks_, ticks);
+}
+#endif
+
+inline uint16_t clampTicks(float value_, float max_)
+{
+    // NaN results in 0
+    value_ = value_ > 0.0f ? value_ : 0.0f;
+    value_ = value_ < max_ ? value_ : max_;
+    return (uint16_t)(value_ + 0.5f);
+}
+
+/**
+ * out = ticks * factor + bias
+ */
+void affineFromTicks(uint16_t const* ticks_, float const* factor_, float const* bias_,
+        float* out_, size_t n_)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for(; i + 8 <= n_; i += 8)
+    {
+        __m256 value = _mm256_mul_ps(loadTicks(ticks_ + i), _mm256_loadu_ps(factor_ + i));
+        _mm256_storeu_ps(out_ + i, _mm256_add_ps(value, _mm256_loadu_ps(bias_ + i)));
+    }
+#elif defined(__SSE2__)
+    for(; i + 4 <= n_; i += 4)
+    {
+        __m128 value = _mm_mul_ps(loadTicks(ticks_ + i), _mm_loadu_ps(factor_ + i));
+        _mm_storeu_ps(out_ + i, _mm_add_ps(value, _mm_loadu_ps(bias_ + i)));
+    }
+#endif
+    for(; i < n_; ++i)
+    {
+        out_[i] = ticks_[i] * factor_[i] + bias_[i];
+    }
+}
+
+/**
+ * ticks = clamp(in * factor + bias, 0, max)
+ */
+void affineToTicks(float const* in_, float const* factor_, float const* bias_,
+        float const* max_, uint16_t* ticks_, size_t n_)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for(; i + 8 <= n_; i += 8)
+    {
+        __m256 value = _mm256_mul_ps(_mm256_loadu_ps(in_ + i), _mm256_loadu_ps(factor_ + i));
+        value = _mm256_add_ps(value, _mm256_loadu_ps(bias_ + i));
+        value = _mm256_max_ps(value, _mm256_setzero_ps());
+        storeTicks(_mm256_min_ps(value, _mm256_loadu_ps(max_ + i)), ticks_ + i);
+    }
+#elif defined(__SSE2__)
+    for(; i + 4 <= n_; i += 4)
+    {
+        __m128 value = _mm_mul_ps(_mm_loadu_ps(in_ + i), _mm_loadu_ps(factor_ + i));
+        value = _mm_add_ps(value, _mm_loadu_ps(bias_ + i));
+        value = _mm_max_ps(value, _mm_setzero_ps());
+        storeTicks(_mm_min_ps(value, _mm_loadu_ps(max_ + i)), ticks_ + i);
+    }
+#endif
+    for(; i < n_; ++i)
+    {
+        ticks_[i] = clampTicks(in_[i] * factor_[i] + bias_[i], max_[i]);
+    }
+}
+
+/**
+ * out = +-(ticks & cMagnitudeMask) * factor, negative if cDirectionBit is set
+ */
+void signMagnitudeFromTicks(uint16_t const* ticks_, float const* factor_, float* out_, size_t n_)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256i const magnitude_mask = _mm256_set1_epi32(cMagnitudeMask);
+    __m256i const direction_bit = _mm256_set1_epi32(cDirectionBit);
+    __m256 const sign_bit = _mm256_set1_ps(-0.0f);
+    for(; i + 8 <= n_; i += 8)
+    {
+        __m256i ticks = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i const*)(ticks_ + i)));
+        __m256 value = _mm256_cvtepi32_ps(_mm256_and_si256(ticks, magnitude_mask));
+        value = _mm256_mul_ps(value, _mm256_loadu_ps(factor_ + i));
+        __m256i cw = _mm256_cmpeq_epi32(_mm256_and_si256(ticks, direction_bit), direction_bit);
+        value = _mm256_xor_ps(value, _mm256_and_ps(_mm256_castsi256_ps(cw), sign_bit));
+        _mm256_storeu_ps(out_ + i, value);
+    }
+#elif defined(__SSE2__)
+    __m128i const magnitude_mask = _mm_set1_epi32(cMagnitudeMask);
+    __m128i const direction_bit = _mm_set1_epi32(cDirectionBit);
+    __m128 const sign_bit = _mm_set1_ps(-0.0f);
+    for(; i + 4 <= n_; i += 4)
+    {
+        __m128i ticks = _mm_loadl_epi64((__m128i const*)(ticks_ + i));
+        ticks = _mm_unpacklo_epi16(ticks, _mm_setzero_si128());
+        __m128 value = _mm_cvtepi32_ps(_mm_and_si128(ticks, magnitude_mask));
+        value = _mm_mul_ps(value, _mm_loadu_ps(factor_ + i));
+        __m128i cw = _mm_cmpeq_epi32(_mm_and_si128(ticks, direction_bit), direction_bit);
+        value = _mm_xor_ps(value, _mm_and_ps(_mm_castsi128_ps(cw), sign_bit));
+        _mm_storeu_ps(out_ + i, value);
+    }
+#endif
+    for(; i < n_; ++i)
+    {
+        float value = (ticks_[i] & cMagnitudeMask) * factor_[i];
+        out_[i] = (ticks_[i] & cDirectionBit) ? -value : value;
+    }
+}
+
+/**
+ * ticks = clamp(|in| * scale, 0, max)
+ */
+void magnitudeToTicks(float const* in_, float const* scale_, float const* max_,
+        uint16_t* ticks_, size_t n_)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256 const sign_bit = _mm256_set1_ps(-0.0f);
+    for(; i + 8 <= n_; i += 8)
+    {
+        __m256 value = _mm256_andnot_ps(sign_bit, _mm256_loadu_ps(in_ + i));
+        value = _mm256_max_ps(_mm256_mul_ps(value, _mm256_loadu_ps(scale_ + i)), _mm256_setzero_ps());
+        storeTicks(_mm256_min_ps(value, _mm256_loadu_ps(max_ + i)), ticks_ + i);
+    }
+#elif defined(__SSE2__)
+    __m128 const sign_bit = _mm_set1_ps(-0.0f);
+    for(; i + 4 <= n_; i += 4)
+    {
+        __m128 value = _mm_andnot_ps(sign_bit, _mm_loadu_ps(in_ + i));
+        value = _mm_max_ps(_mm_mul_ps(value, _mm_loadu_ps(scale_ + i)), _mm_setzero_ps());
+        storeTicks(_mm_min_ps(value, _mm_loadu_ps(max_ + i)), ticks_ + i);
+    }
+#endif
+    for(; i < n_; ++i)
+    {
+        float value = in_[i] < 0.0f ? -in_[i] : in_[i];
+        ticks_[i] = clampTicks(value * scale_[i], max_[i]);
+    }
+}
+
+inline float inverse(float value_)
+{
+    return value_ != 0.0f ? 1.0f / value_ : 0.0f;
+}
+
+} // end anonymous namespace
+
+void UnitConverter::add(ServoConfiguration const& config_)
+{
+    float sign = config_.reverse ? -1.0f : 1.0f;
+    float range = config_.positionRange > 0.0f ? config_.positionRange : 0.0f;
+    range = range < 65535.0f ? range : 65535.0f;
+
+    // reverse: ticks = range - (rad + offset) * scale
+    mPositionFactor.push_back(sign * inverse(config_.positionScale));
+    mPositionBias.push_back(config_.reverse ?
+            range * inverse(config_.positionScale) - config_.positionOffset :
+            -config_.positionOffset);
+    mPositionTicksFactor.push_back(sign * config_.positionScale);
+    mPositionTicksBias.push_back(config_.reverse ?
+            range - config_.positionOffset * config_.positionScale :
+            config_.positionOffset * config_.positionScale);
+    mPositionRange.push_back(range);
+
+    mSpeedFactor.push_back(sign * inverse(config_.speedScale));
+    mSpeedScale.push_back(config_.speedScale);
+    mEffortFactor.push_back(sign * inverse(config_.effortScale));
+    mEffortScale.push_back(config_.effortScale);
+    mMaxSpeedLoadTicks.push_back(cMaxSpeedLoadTicks);
+}
+
+void UnitConverter::ticksToPositions(uint16_t const* ticks_, float* positions_) const
+{
+    if(size() == 0)
+        return;
+    affineFromTicks(ticks_, &mPositionFactor[0], &mPositionBias[0], positions_, size());
+}
+
+void UnitConverter::positionsToTicks(float const* positions_, uint16_t* ticks_) const
+{
+    if(size() == 0)
+        return;
+    affineToTicks(positions_, &mPositionTicksFactor[0], &mPositionTicksBias[0],
+            &mPositionRange[0], ticks_, size());
+}
+
+void UnitConverter::ticksToSpeeds(uint16_t const* ticks_, float* speeds_) const
+{
+    if(size() == 0)
+        return;
+    signMagnitudeFromTicks(ticks_, &mSpeedFactor[0], speeds_, size());
+}
+
+void UnitConverter::speedsToTicks(float const* speeds_, uint16_t* ticks_) const
+{
+    if(size() == 0)
+        return;
+    magnitudeToTicks(speeds_, &mSpeedScale[0], &mMaxSpeedLoadTicks[0], ticks_, size());
+}
+
+void UnitConverter::ticksToEfforts(uint16_t const* ticks_, float* efforts_) const
+{
+    if(size() == 0)
+        return;
+    signMagnitudeFromTicks(ticks_, &mEffortFactor[0], efforts_, size());
+}
+
+void UnitConverter::effortsToTicks(float const* efforts_, uint16_t* ticks_) const
+{
+    if(size() == 0)
+        return;
+    magnitudeToTicks(efforts_, &mEffortScale[0], &mMaxSpeedLoadTicks[0], ticks_, size());
+}
+
+} // end namespace servo_dynamixel
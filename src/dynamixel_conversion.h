@@ -0,0 +1,108 @@
+/**
+ * \file dynamixel_conversion.h
+ *
+ * \brief   Converts arrays of Dynamixel ticks to SI units and back.
+ *
+ * \details The conversion parameters of all servos are taken from their
+ *          servo_dynamixel::ServoConfiguration and kept as arrays, so whole arrays
+ *          (e.g. DynamixelStateStore::positions()) are converted at once.
+ *          The kernels use AVX2 or SSE2 if the compiler targets them
+ *          (e.g. -mavx2), otherwise a scalar implementation.
+ */
+
+#ifndef DYNAMIXEL_CONVERSION_H_
+#define DYNAMIXEL_CONVERSION_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include "dynamixel_types.hpp"
+
+namespace servo_dynamixel {
+
+/**
+ * \class UnitConverter
+ * Converts between Protocol 1.0 register values and rad, rad/s and Nm.
+ * All functions convert size() values, one per added servo in the order
+ * the servos have been added.
+ */
+class UnitConverter
+{
+ public:
+    /** Largest value of the speed and load registers. */
+    static uint16_t const cMaxSpeedLoadTicks = 1023;
+
+    /**
+     * Adds the servo described by \a config_.
+     * positionScale, speedScale and effortScale should not be 0, otherwise
+     * every value of the servo is converted to 0.
+     */
+    void add(ServoConfiguration const& config_);
+
+    /**
+     * Number of servos.
+     */
+    inline size_t size() const
+    {
+        return mPositionFactor.size();
+    }
+
+    /**
+     * Present Position ticks to rad:
+     * pos_rad = ticks / positionScale - positionOffset, with ticks = positionRange - ticks
+     * if reverse is set.
+     */
+    void ticksToPositions(uint16_t const* ticks_, float* positions_) const;
+
+    /**
+     * Goal Position in rad to ticks, the inverse of ticksToPositions().
+     * The result is clamped to [0, positionRange].
+     */
+    void positionsToTicks(float const* positions_, uint16_t* ticks_) const;
+
+    /**
+     * Present Speed ticks (bit 10 is the direction, set for CW) to rad/s,
+     * CCW is positive unless reverse is set.
+     */
+    void ticksToSpeeds(uint16_t const* ticks_, float* speeds_) const;
+
+    /**
+     * Speed in rad/s to Moving Speed ticks (joint mode), the absolute value is used.
+     * The result is clamped to [0, cMaxSpeedLoadTicks].
+     */
+    void speedsToTicks(float const* speeds_, uint16_t* ticks_) const;
+
+    /**
+     * Present Load ticks (bit 10 is the direction, set for CW) to Nm,
+     * CCW is positive unless reverse is set.
+     */
+    void ticksToEfforts(uint16_t const* ticks_, float* efforts_) const;
+
+    /**
+     * Effort in Nm to Torque Limit ticks, the absolute value is used.
+     * The result is clamped to [0, cMaxSpeedLoadTicks].
+     */
+    void effortsToTicks(float const* efforts_, uint16_t* ticks_) const;
+
+ private:
+    // value = ticks * factor + bias
+    std::vector<float> mPositionFactor;
+    std::vector<float> mPositionBias;
+    // ticks = value * factor + bias
+    std::vector<float> mPositionTicksFactor;
+    std::vector<float> mPositionTicksBias;
+    std::vector<float> mPositionRange;
+    // value = +-magnitude * factor, the sign of the factor contains reverse
+    std::vector<float> mSpeedFactor;
+    std::vector<float> mSpeedScale;
+    std::vector<float> mEffortFactor;
+    std::vector<float> mEffortScale;
+    // cMaxSpeedLoadTicks for every servo
+    std::vector<float> mMaxSpeedLoadTicks;
+};
+
+} // end namespace servo_dynamixel
+
+#endif
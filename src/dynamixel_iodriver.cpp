@@ -2,12 +2,26 @@
 
 #include "dynamixel_iodriver.h"
 
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
 #include <base-logging/Logging.hpp>
 
 /////////////////////////////// PUBLIC ///////////////////////////////////////
 DynamixelIODriver::DynamixelIODriver() : iodrivers_base::Driver(cMaxPacketSize)
 {
     mTimeout = cDefaultTimeout_ms;
+    mBaudRate = cDefaultBaudRate;
+    mTimeoutMargin_us = cDefaultTimeoutMargin_us;
+    mReceivedSize = 0;
+    clearExpectedAnswer();
+    mDiscardedPackets = 0;
+    mProtocol = PROTOCOL_1;
+    resetFrame();
 }
 
 DynamixelIODriver::~DynamixelIODriver()
@@ -23,6 +37,13 @@ void DynamixelIODriver::close()
     iodrivers_base::Driver::close();
 }
 
+void DynamixelIODriver::clear()
+{
+    iodrivers_base::Driver::clear();
+    mReceivedSize = 0;
+    resetFrame();
+}
+
 bool DynamixelIODriver::open(std::string const& uri_) {
     try {
         iodrivers_base::Driver::openURI(uri_);
@@ -31,9 +52,161 @@ bool DynamixelIODriver::open(std::string const& uri_) {
                 uri_.c_str());
         return false;
     }
+    // serial://path/to/device:baudrate
+    std::string::size_type colon = uri_.rfind(':');
+    if(uri_.compare(0, 9, "serial://") == 0 && colon != std::string::npos && colon > 9)
+    {
+        // an invalid baud rate keeps the previous one, the wire time divides by it
+        setBaudRate(atoi(uri_.c_str() + colon + 1));
+    }
     return true;
 }
 
+base::Time DynamixelIODriver::getWireTime(int const bytes_) const
+{
+    return base::Time::fromMicroseconds(bytes_ * 10 * 1000000LL / mBaudRate);
+}
+
+base::Time DynamixelIODriver::getAnswerTimeout(int const request_bytes_, int const answer_bytes_,
+        base::Time const& return_delay_) const
+{
+    base::Time timeout = getWireTime(request_bytes_ + answer_bytes_) + return_delay_ +
+            base::Time::fromMicroseconds(mTimeoutMargin_us);
+    base::Time ceiling = base::Time::fromMilliseconds(mTimeout);
+    return timeout < ceiling ? timeout : ceiling;
+}
+
+void DynamixelIODriver::clearExpectedAnswer()
+{
+    mExpecting = false;
+    for(int i=0; i<256; i++)
+    {
+        mExpectedParameters[i] = -1;
+    }
+}
+
+DynamixelIODriver::TransferResult DynamixelIODriver::tryWritePacket(uint8_t const* buffer_,
+        int buffer_size, base::Time const& timeout_)
+{
+    int fd = getFileDescriptor();
+    if(fd < 0)
+    {
+        try {
+            return writePacket(buffer_, buffer_size) ? TRANSFER_OK : TRANSFER_IO_ERROR;
+        } catch(iodrivers_base::TimeoutError& e) {
+            return TRANSFER_TIMEOUT;
+        } catch(std::runtime_error& e) {
+            return TRANSFER_IO_ERROR;
+        }
+    }
+
+    // every byte received so far precedes the request and cannot answer it, including
+    // the bytes buffered by readPacket()
+    clear();
+
+    base::Time deadline = base::Time::now() + timeout_;
+    int written = 0;
+    while(written < buffer_size)
+    {
+        ssize_t result = ::write(fd, buffer_ + written, buffer_size - written);
+        if(result > 0)
+        {
+            written += result;
+            continue;
+        }
+        if(result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            return TRANSFER_IO_ERROR;
+        }
+        TransferResult wait = waitFor(POLLOUT, deadline - base::Time::now());
+        if(wait != TRANSFER_OK)
+        {
+            return wait;
+        }
+    }
+    return TRANSFER_OK;
+}
+
+DynamixelIODriver::TransferResult DynamixelIODriver::tryReadPacket(uint8_t* buffer_,
+        int buffer_size, base::Time const& timeout_, int& packet_size_)
+{
+    packet_size_ = 0;
+    int fd = getFileDescriptor();
+    if(fd < 0)
+    {
+        try {
+            packet_size_ = readPacket(buffer_, buffer_size, timeout_);
+            return TRANSFER_OK;
+        } catch(iodrivers_base::TimeoutError& e) {
+            return TRANSFER_TIMEOUT;
+        } catch(std::runtime_error& e) {
+            return TRANSFER_IO_ERROR;
+        }
+    }
+
+    base::Time deadline = base::Time::now() + timeout_;
+    // a tty with VMIN=0 and VTIME=0 (as configured by iodrivers_base) returns 0 if no
+    // data is available, for sockets and pipes 0 is the end of the stream
+    bool tty = isatty(fd);
+    // the frame state may belong to the buffer of readPacket()
+    resetFrame();
+    for(;;)
+    {
+        // the bytes left by the previous call are checked first
+        while(mReceivedSize > 0)
+        {
+            int result = extractPacket(mReceived, mReceivedSize);
+            if(result == 0)
+            {
+                break;
+            }
+            int size = result > 0 ? result : -result;
+            if(result > 0)
+            {
+                if(result > buffer_size)
+                {
+                    resetFrame();
+                    return TRANSFER_IO_ERROR;
+                }
+                memcpy(buffer_, mReceived, result);
+                packet_size_ = result;
+            }
+            mReceivedSize -= size;
+            memmove(mReceived, mReceived + size, mReceivedSize);
+            if(result > 0)
+            {
+                resetFrame();
+                return TRANSFER_OK;
+            }
+        }
+
+        if(mReceivedSize == (int)sizeof(mReceived))
+        {
+            // cannot happen, packets are smaller than half the buffer
+            mReceivedSize = 0;
+            resetFrame();
+        }
+        ssize_t result = ::read(fd, mReceived + mReceivedSize, sizeof(mReceived) - mReceivedSize);
+        if(result > 0)
+        {
+            mReceivedSize += result;
+            continue;
+        }
+        if((result == 0 && !tty) ||
+                (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            resetFrame();
+            return TRANSFER_IO_ERROR;
+        }
+        TransferResult wait = waitFor(POLLIN, deadline - base::Time::now());
+        if(wait != TRANSFER_OK)
+        {
+            resetFrame();
+            return wait;
+        }
+    }
+}
+
 /////////////////////////////// PROTECTED ////////////////////////////////////
 /*
  * There is four possible cases:
@@ -47,56 +220,190 @@ bool DynamixelIODriver::open(std::string const& uri_) {
  * - there is a full packet in \c buffer, starting at the first buffer byte.
  *   Return the packet size. That data will be copied back to the buffer
  *   given to readPacket.
+ *
+ * If 0 is returned, the buffer will start with the same bytes on the next call.
+ * The header and the checksum of the bytes seen so far are kept (see resetFrame()),
+ * so only the new bytes have to be checked.
  */
 int DynamixelIODriver::extractPacket(uint8_t const* buffer, size_t buffer_size) const {
+    if(mProtocol == PROTOCOL_2) {
+        return extractPacket2(buffer, buffer_size);
+    }
+    return extractPacket1(buffer, buffer_size);
+}
+
+/////////////////////////////// PRIVATE //////////////////////////////////////
+int DynamixelIODriver::extractPacket1(uint8_t const* buffer, size_t buffer_size) const {
 
-    for(unsigned int i=0; i<buffer_size; i++) {
-        LOG_DEBUG("Read 0x%x(%d)", buffer[i], buffer[i]);
+    int size = (int)buffer_size;
+    if(mFrameHeaderSize != 0 && (size < mFrameScanned ||
+            memcmp(buffer, mFrameHeader, mFrameHeaderSize) != 0)) {
+        resetFrame();
     }
 
-    // get at least '0xFF 0xFF ID LENGTH'          
-    if(buffer_size >= 6) 
-    {
-        int length = dxGetStatusLength(buffer, buffer_size);
-        LOG_DEBUG("status packet length 0x%x(%d)", length, length);
+    if(mFrameHeaderSize == 0) {
+        // find '0xFF 0xFF ID LENGTH', the id 0xFF is not used by status packets
+        if(size == 0) {
+            return 0;
+        }
+        if(buffer[0] != 0xff) {
+            return -findSync(buffer, buffer_size);
+        }
+        if((size > 1 && buffer[1] != 0xff) || (size > 2 && buffer[2] == 0xff)) {
+            return -1;
+        }
+        if(size < 4) {
+            return 0; // need more data
+        }
+        // error byte and checksum at least
+        if(buffer[3] < 2) {
+            LOG_ERROR("invalid length %d detected, header will be discarded", buffer[3]);
+            return -2;
+        }
+        startFrame(buffer, 4, buffer[3] + 4, 2);
+    }
 
-        // 0: packet doesnt start at the start of the buffer or packet incomplete
-        //<0: invalid checksum
-        //>0: length of the packet
-        if(length != 0) 
-        {
-            if(length < 0) {
-                LOG_ERROR("invalid checksum detected, packet will be discarded");
-                return length; // Discard complete packet.
-            } else {
-                // complete packet available?
-                if(buffer_size >= (unsigned int)length) {
-                    LOG_DEBUG("complete packet available");
-                    return length; //packet in the buffer, returns the packet size
-                } else {
-                    LOG_DEBUG("packet incomplete, need more data");
-                    return 0; // need more data
-                }
+    // checksum of ID, LENGTH, ERROR and the parameters
+    int end = size < mFrameSize - 1 ? size : mFrameSize - 1;
+    for(int i=mFrameScanned; i<end; i++) {
+        mFrameChecksum += buffer[i];
+    }
+    mFrameScanned = end;
+    if(size < mFrameSize) {
+        return 0; // need more data
+    }
+
+    int packet_size = mFrameSize;
+    bool valid = ((~mFrameChecksum) & 0xff) == buffer[packet_size - 1];
+    resetFrame();
+    if(!valid) {
+        // the header may be noise, resync behind it
+        LOG_ERROR("invalid checksum detected, header will be discarded");
+        return -2;
+    }
+    // a complete packet which does not answer the outstanding request, e.g. a late
+    // answer to a request which already timed out. A servo rejecting the request
+    // answers with a rejection error bit and no parameters, e.g. overload stays set
+    // on every status packet and does not identify the answer.
+    bool rejected = buffer[3] == 2 && (buffer[4] & DX_REJECTION_ERRORS) != 0;
+    int expected = mExpectedParameters[buffer[2]];
+    if(mExpecting && (expected < 0 || (buffer[3] != expected + 2 && !rejected))) {
+        LOG_WARN("stale status packet of ID %d with %d parameters discarded", buffer[2], buffer[3] - 2);
+        ++mDiscardedPackets;
+        return -packet_size;
+    }
+    return packet_size;
+}
+
+int DynamixelIODriver::extractPacket2(uint8_t const* buffer, size_t buffer_size) const {
+
+    static uint8_t const sync[4] = {0xff, 0xff, 0xfd, 0x00};
+
+    int size = (int)buffer_size;
+    if(mFrameHeaderSize != 0 && (size < mFrameScanned ||
+            memcmp(buffer, mFrameHeader, mFrameHeaderSize) != 0)) {
+        resetFrame();
+    }
+
+    if(mFrameHeaderSize == 0) {
+        // find '0xFF 0xFF 0xFD 0x00 ID LEN_L LEN_H'
+        if(size == 0) {
+            return 0;
+        }
+        if(buffer[0] != 0xff) {
+            return -findSync(buffer, buffer_size);
+        }
+        for(int i=1; i<4 && i<size; i++) {
+            if(buffer[i] != sync[i]) {
+                return -1;
             }
         }
+        if(size < DX2_HEADER_SIZE) {
+            return 0; // need more data
+        }
+        int length = DX2_HEADER_SIZE + (buffer[5] | (buffer[6] << 8));
+        if(length < DX2_MIN_PACKET_SIZE || length > cMaxPacketSize) {
+            LOG_ERROR("invalid packet size %d detected, header will be discarded", length);
+            return -4;
+        }
+        startFrame(buffer, DX2_HEADER_SIZE, length, 0);
+    }
+
+    // crc of everything but the crc itself
+    int end = size < mFrameSize - 2 ? size : mFrameSize - 2;
+    if(end > mFrameScanned) {
+        mFrameChecksum = dx2UpdateCRC(mFrameChecksum, buffer + mFrameScanned, end - mFrameScanned);
+        mFrameScanned = end;
+    }
+    if(size < mFrameSize) {
+        return 0; // need more data
     }
 
-    LOG_DEBUG("buffer size %d", buffer_size);
+    int packet_size = mFrameSize;
+    bool valid = (mFrameChecksum & 0xff) == buffer[packet_size - 2] &&
+            ((mFrameChecksum >> 8) & 0xff) == buffer[packet_size - 1];
+    resetFrame();
+    if(!valid) {
+        // the header may be noise, resync behind it
+        LOG_ERROR("invalid crc detected, header will be discarded");
+        return -4;
+    }
+    return packet_size;
+}
+
+int DynamixelIODriver::findSync(uint8_t const* buffer, size_t buffer_size) {
+    void const* sync = memchr(buffer, 0xff, buffer_size);
+    return sync != NULL ? (int)((uint8_t const*)sync - buffer) : (int)buffer_size;
+}
+
+void DynamixelIODriver::startFrame(uint8_t const* buffer, int const header_size, int const packet_size,
+        int const checksum_start) const {
+    memcpy(mFrameHeader, buffer, header_size);
+    mFrameHeaderSize = header_size;
+    mFrameSize = packet_size;
+    mFrameScanned = checksum_start;
+    mFrameChecksum = 0;
+}
+
+void DynamixelIODriver::resetFrame() const {
+    mFrameHeaderSize = 0;
+    mFrameSize = 0;
+    mFrameScanned = 0;
+    mFrameChecksum = 0;
+}
 
-    // find first 0xff marker
-    // The previous implementation got problems with 0 0xff
-    unsigned int i=0;
-    while(i<buffer_size && buffer[i] != 0xff)
+DynamixelIODriver::TransferResult DynamixelIODriver::waitFor(short const events_, base::Time const& timeout_)
+{
+    int64_t timeout_us = timeout_.toMicroseconds();
+    if(timeout_us <= 0)
     {
-        LOG_DEBUG("Ignore byte 0x%x (%d)", buffer[i], buffer[i]);
-        i++;
-    }
-    // Remove 0xff as well if the next byte is available and if it is not 0xff.
-    if(i < (buffer_size - 1) && buffer[i+1] != 0xff) {
-        LOG_DEBUG("Ignore byte 0x%x (%d)", buffer[i], buffer[i]);
-        i++;
-    } 
-    LOG_DEBUG("return byte 0x%x (%d)", -i, -i);
-    int ret = (int)i;
-    return -ret;
+        return TRANSFER_TIMEOUT;
+    }
+    struct pollfd poll_fd;
+    poll_fd.fd = getFileDescriptor();
+    poll_fd.events = events_;
+    poll_fd.revents = 0;
+    struct timespec timeout;
+    timeout.tv_sec = timeout_us / 1000000;
+    timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+
+    int result = ppoll(&poll_fd, 1, &timeout, NULL);
+    if(result == 0)
+    {
+        return TRANSFER_TIMEOUT;
+    }
+    if(result < 0)
+    {
+        return errno == EINTR ? TRANSFER_OK : TRANSFER_IO_ERROR;
+    }
+    if(poll_fd.revents & (POLLERR | POLLNVAL))
+    {
+        return TRANSFER_IO_ERROR;
+    }
+    // the remaining data of a closed connection is read before the hang up is reported
+    if((poll_fd.revents & POLLHUP) && !(poll_fd.revents & events_))
+    {
+        return TRANSFER_IO_ERROR;
+    }
+    return TRANSFER_OK;
 }
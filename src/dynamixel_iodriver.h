@@ -4,7 +4,16 @@
  * \brief   Inherits from iodrivers_base::Driver and specialized the serial communication
  *          for the dynamixel servos.
  *
- * \details Implements the virtual function extractPacket(), see for details.          
+ * \details Implements the virtual function extractPacket(), see for details.
+ *          Status packets are framed either according to the Dynamixel Protocol 1.0
+ *          (default) or 2.0, see setProtocol().
+ *          Answers can be awaited with a deadline derived from the wire time of the
+ *          packets, see getAnswerTimeout(). The fixed timeout is the upper limit.
+ *          tryWritePacket() and tryReadPacket() report timeouts and I/O errors as
+ *          TransferResult instead of throwing iodrivers_base exceptions.
+ *          Bytes received before tryWritePacket() sends a request belong to an earlier
+ *          request and are discarded. Complete Protocol 1.0 status packets which do not
+ *          match the expected answer (see setExpectedAnswer()) are dropped by the framer.
  *      
  *          German Research Center for Artificial Intelligence\n
  *          Project: AG Framework, Spaceclimber
@@ -17,10 +26,12 @@
 #ifndef DYNAMIXEL_IODRIVER_H_
 #define DYNAMIXEL_IODRIVER_H_
 
+#include <base/Time.hpp>
 #include <iodrivers_base/Driver.hpp>
 
 extern "C" {
 #include "dxseries.h"
+#include "dxseries2.h"
 }
 
 #define DISALLOW_COPY_AND_ASSIGN(TypeName) \
@@ -35,6 +46,25 @@ extern "C" {
 class DynamixelIODriver : public iodrivers_base::Driver
 {
  public:
+    /**
+     * Dynamixel communication protocol used to frame the status packets.
+     */
+    enum Protocol
+    {
+        PROTOCOL_1 = 1, ///0xFF 0xFF header, 8 bit checksum (DX, AX, RX, MX series)
+        PROTOCOL_2 = 2  ///0xFF 0xFF 0xFD 0x00 header, CRC16 and byte stuffing (X series)
+    };
+
+    /**
+     * Result of tryWritePacket() and tryReadPacket().
+     */
+    enum TransferResult
+    {
+        TRANSFER_OK = 0,
+        TRANSFER_TIMEOUT,   ///nothing or only a part of a packet within the timeout
+        TRANSFER_IO_ERROR   ///the file descriptor reported an error or has been closed
+    };
+
     DynamixelIODriver();
     /**
      * Closes the serial communication.
@@ -52,6 +82,66 @@ class DynamixelIODriver : public iodrivers_base::Driver
     {
         return mTimeout;
     }
+    /**
+     * Returns the baud rate, taken from the URI of open() or set by setBaudRate().
+     */
+    inline int getBaudRate() const
+    {
+        return mBaudRate;
+    }
+    /**
+     * Sets the baud rate used to compute the wire time of packets, e.g. if the
+     * servos are reached by TCP. Does not change the serial settings.
+     * \return false if \a baud_rate_ is not positive, the baud rate is kept then.
+     */
+    inline bool setBaudRate(int const baud_rate_)
+    {
+        if(baud_rate_ <= 0)
+        {
+            return false;
+        }
+        mBaudRate = baud_rate_;
+        return true;
+    }
+    /**
+     * Returns the safety margin in us added to the wire time, see getAnswerTimeout().
+     */
+    inline int getTimeoutMargin() const
+    {
+        return mTimeoutMargin_us;
+    }
+    /**
+     * Sets the safety margin in us added to the wire time. It has to cover the latency
+     * of the serial adapter and the scheduler, e.g. the 16 ms default latency timer
+     * of FTDI adapters. Reduce it if the adapter runs in low latency mode.
+     */
+    inline void setTimeoutMargin(int const margin_us_)
+    {
+        mTimeoutMargin_us = margin_us_;
+    }
+    /**
+     * Returns the time needed to transmit \a bytes_ bytes (start bit, 8 data bits
+     * and stop bit each) at the current baud rate.
+     */
+    base::Time getWireTime(int const bytes_) const;
+    /**
+     * Returns the time to wait for an answer of \a answer_bytes_ bytes to a request of
+     * \a request_bytes_ bytes, which has just been written: the wire time of both packets,
+     * the \a return_delay_ of the servo and the safety margin. \a mTimeout is the upper limit.
+     */
+    base::Time getAnswerTimeout(int const request_bytes_, int const answer_bytes_,
+            base::Time const& return_delay_) const;
+    /**
+     * Returns the protocol which is used to extract the status packets.
+     */
+    inline Protocol getProtocol() const
+    {
+        return mProtocol;
+    }
+    /**
+     * Discards the received bytes, see iodrivers_base::Driver::clear().
+     */
+    void clear();
     /**
      * Invokes the open functions of IODrivers, using the URI to select the device.
      * \param uri_ device URI like \a serial://path/to/device:baudrate or tcp://hostname:port.
@@ -64,6 +154,81 @@ class DynamixelIODriver : public iodrivers_base::Driver
     {
         return iodrivers_base::Driver::readPacket(buffer_, buffer_size, mTimeout);
     }
+    /**
+     * Selects the protocol which is used to extract the status packets, by default PROTOCOL_1.
+     */
+    inline void setProtocol(Protocol const protocol_)
+    {
+        mProtocol = protocol_;
+        resetFrame();
+    }
+    /**
+     * Invokes the function readPacket of IODriver with the timeout \a timeout_ in ms.
+     */
+    inline int readPacket(uint8_t* buffer_, int buffer_size, int const timeout_)
+    {
+        return iodrivers_base::Driver::readPacket(buffer_, buffer_size, timeout_);
+    }
+    /**
+     * Invokes the function readPacket of IODriver with the timeout \a timeout_,
+     * e.g. a result of getAnswerTimeout().
+     */
+    inline int readPacket(uint8_t* buffer_, int buffer_size, base::Time const& timeout_)
+    {
+        return iodrivers_base::Driver::readPacket(buffer_, buffer_size, timeout_);
+    }
+    /**
+     * Only Protocol 1.0 status packets of the servo \a id_ with \a parameters_ parameters
+     * are extracted from now on, others are discarded, see getDiscardedPackets().
+     * A packet of the servo without parameters but with a DX_REJECTION_ERRORS bit is
+     * extracted as well, servos reject invalid requests this way.
+     */
+    inline void setExpectedAnswer(uint8_t const id_, int const parameters_)
+    {
+        clearExpectedAnswer();
+        addExpectedAnswer(id_, parameters_);
+    }
+    /**
+     * Extracts the answer of the servo \a id_ with \a parameters_ parameters as well,
+     * e.g. for the answers of a bulk read. See setExpectedAnswer().
+     */
+    inline void addExpectedAnswer(uint8_t const id_, int const parameters_)
+    {
+        mExpectedParameters[id_] = parameters_;
+        mExpecting = true;
+    }
+    /**
+     * Extracts all status packets again, see setExpectedAnswer().
+     */
+    void clearExpectedAnswer();
+    /**
+     * Number of status packets discarded because they did not match the expected answer.
+     */
+    inline unsigned int getDiscardedPackets() const
+    {
+        return mDiscardedPackets;
+    }
+    /**
+     * Writes \a buffer_size bytes of \a buffer_ within \a timeout_ without throwing.
+     * Received bytes which have not been extracted yet, including the bytes buffered
+     * by readPacket(), are discarded first, see clear(). Like tryReadPacket(), this
+     * bypasses the IO listeners and the statistics of iodrivers_base::Driver.
+     */
+    TransferResult tryWritePacket(uint8_t const* buffer_, int buffer_size, base::Time const& timeout_);
+    /**
+     * Waits up to \a timeout_ for a packet like readPacket(), but without throwing:
+     * the file descriptor is polled directly and the received bytes are kept in a
+     * buffer of this class. On TRANSFER_OK \a packet_size_ contains the size of
+     * the packet copied to \a buffer_.
+     * Falls back to the exception based readPacket() if the transport does not
+     * provide a file descriptor. Do not interleave with readPacket() while a packet
+     * is being received. The end of a socket or pipe is a TRANSFER_IO_ERROR.
+     * Reading the file descriptor directly bypasses the IO listeners and the
+     * statistics of iodrivers_base::Driver, the bytes received this way are
+     * neither reported to the listeners nor counted.
+     */
+    TransferResult tryReadPacket(uint8_t* buffer_, int buffer_size, base::Time const& timeout_,
+            int& packet_size_);
     /**
      * Sets the timeout which represents the time in ms to wait for a serial answer.
      */
@@ -88,11 +253,60 @@ class DynamixelIODriver : public iodrivers_base::Driver
     int extractPacket(uint8_t const* buffer, size_t buffer_size) const;
 
  private:
-    static const int cMaxPacketSize = 56; ///maximal size of a packet
+    /**
+     * extractPacket() for Protocol 1.0 status packets.
+     */
+    int extractPacket1(uint8_t const* buffer, size_t buffer_size) const;
+    /**
+     * extractPacket() for Protocol 2.0 status packets.
+     */
+    int extractPacket2(uint8_t const* buffer, size_t buffer_size) const;
+    /**
+     * Returns the number of bytes in front of the next 0xFF (possible start of a packet).
+     */
+    static int findSync(uint8_t const* buffer, size_t buffer_size);
+    /**
+     * Starts a new frame with the \a header_size header bytes of \a buffer
+     * and the packet size \a packet_size. The checksum starts at \a checksum_start.
+     */
+    void startFrame(uint8_t const* buffer, int const header_size, int const packet_size,
+            int const checksum_start) const;
+    /**
+     * Forgets the current frame, e.g. if a packet has been returned or the
+     * buffer does not start with the stored header anymore.
+     */
+    void resetFrame() const;
+    /**
+     * Waits up to \a timeout_ for the file descriptor to become readable
+     * (\a events_ POLLIN) or writable (POLLOUT). Returns TRANSFER_IO_ERROR
+     * on an error or a hang up of the file descriptor.
+     */
+    TransferResult waitFor(short const events_, base::Time const& timeout_);
+
+    static const int cMaxPacketSize = 512; ///maximal size of a packet (Protocol 2.0 allows long packets)
     static const int cDefaultBaudRate = 57600; ///default baud rate
     static const int cDefaultTimeout_ms = 2000; ///default timeout to wait for an answer
+    static const int cDefaultTimeoutMargin_us = 20000; ///default margin added to the wire time
 
     int mTimeout; ///current timeout
+    int mBaudRate; ///baud rate used to compute the wire time
+    int mTimeoutMargin_us; ///margin added to the wire time
+
+    uint8_t mReceived[2 * cMaxPacketSize]; ///bytes received by tryReadPacket()
+    int mReceivedSize; ///number of bytes in mReceived
+
+    bool mExpecting; ///false if any packet is extracted
+    int mExpectedParameters[256]; ///number of parameters of the expected answer by ID, -1 if none
+    mutable unsigned int mDiscardedPackets; ///packets dropped by setExpectedAnswer()
+    Protocol mProtocol; ///protocol of the status packets
+
+    // State of the incomplete packet at the start of the buffer, kept between the
+    // calls of extractPacket() so that every byte is only checked once.
+    mutable uint8_t mFrameHeader[DX2_HEADER_SIZE]; ///header of the packet
+    mutable int mFrameHeaderSize; ///number of bytes in mFrameHeader, 0 if no packet has been started
+    mutable int mFrameSize; ///size of the packet
+    mutable int mFrameScanned; ///number of bytes added to mFrameChecksum
+    mutable DX_UINT16 mFrameChecksum; ///running checksum (Protocol 1.0) or crc (Protocol 2.0)
 
     DISALLOW_COPY_AND_ASSIGN(DynamixelIODriver);
 };
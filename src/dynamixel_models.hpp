@@ -0,0 +1,185 @@
+#ifndef DYNAMIXEL_MODELS_HPP__
+#define DYNAMIXEL_MODELS_HPP__
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "dynamixel_registers.hpp"
+
+namespace servo_dynamixel {
+
+/**
+ * Values of the Model Number register.
+ */
+enum MODEL_NUMBER {
+    MODEL_AX_12 = 12,
+    MODEL_AX_18 = 18,
+    MODEL_RX_28 = 28,
+    MODEL_MX_28 = 29,
+    MODEL_RX_64 = 64,
+    MODEL_DX_116 = 116,
+    MODEL_MX_64 = 310,
+    MODEL_MX_106 = 320
+};
+
+/**
+ * Registers shared by all Protocol 1.0 models, see dynamixel_registers.hpp.
+ */
+struct Protocol1Model
+{
+    typedef dx::ModelNumber ModelNumber;
+    typedef dx::CWAngleLimit CWAngleLimit;
+    typedef dx::CCWAngleLimit CCWAngleLimit;
+    typedef dx::TorqueEnable TorqueEnable;
+    typedef dx::GoalPosition GoalPosition;
+    typedef dx::MovingSpeed MovingSpeed;
+    typedef dx::TorqueLimit TorqueLimit;
+    typedef dx::PresentPosition PresentPosition;
+    typedef dx::PresentSpeed PresentSpeed;
+    typedef dx::PresentLoad PresentLoad;
+    typedef dx::PresentVoltage PresentVoltage;
+    typedef dx::PresentTemperature PresentTemperature;
+
+    /** Largest value of the speed and load registers. */
+    static const int cSpeedLoadMax = 1023;
+};
+
+/**
+ * AX, RX and DX series: compliance margin and slope.
+ */
+struct ComplianceModel : public Protocol1Model
+{
+    typedef dx::CWComplianceMargin CWComplianceMargin;
+    typedef dx::CCWComplianceMargin CCWComplianceMargin;
+    typedef dx::CWComplianceSlope CWComplianceSlope;
+    typedef dx::CCWComplianceSlope CCWComplianceSlope;
+
+    static const bool cHasCompliance = true;
+    /** 0° to 300° with 1024 steps. */
+    static const int cAngleRange = 300;
+    static const int cPositionMax = 1023;
+};
+
+/**
+ * MX series: the compliance registers contain the PID gains.
+ */
+struct PidModel : public Protocol1Model
+{
+    typedef dx::DGain DGain;
+    typedef dx::IGain IGain;
+    typedef dx::PGain PGain;
+
+    static const bool cHasCompliance = false;
+    /** 0° to 360° with 4096 steps. */
+    static const int cAngleRange = 360;
+    static const int cPositionMax = 4095;
+};
+
+/**
+ * Compile time traits of the servo model \a Number (see MODEL_NUMBER), e.g.
+ * ServoModel<MODEL_MX_28>::PresentPosition or ModelScales<ServoModel<MODEL_MX_28> >::positionScale().
+ * Only the specialized models are available.
+ */
+template <int Number>
+struct ServoModel;
+
+#define DYNAMIXEL_SERVO_MODEL(number, base, model_name, rpm_per_step, stall_torque) \
+template <> \
+struct ServoModel<number> : public base \
+{ \
+    static const int cModelNumber = number; \
+    static const char* name() { return model_name; } \
+    /** Speed register: rpm per step. */ \
+    static double rpmPerStep() { return rpm_per_step; } \
+    /** Stall torque in Nm. */ \
+    static double stallTorque() { return stall_torque; } \
+}
+
+DYNAMIXEL_SERVO_MODEL(MODEL_AX_12, ComplianceModel, "AX-12", 0.111, 1.5);   // 12V
+DYNAMIXEL_SERVO_MODEL(MODEL_AX_18, ComplianceModel, "AX-18", 0.111, 1.8);   // 12V
+DYNAMIXEL_SERVO_MODEL(MODEL_RX_28, ComplianceModel, "RX-28", 0.111, 3.7);   // 18.5V
+DYNAMIXEL_SERVO_MODEL(MODEL_RX_64, ComplianceModel, "RX-64", 0.111, 6.4);   // 18.5V
+DYNAMIXEL_SERVO_MODEL(MODEL_DX_116, ComplianceModel, "DX-116", 70.0 / 1023, 2.5); // 12V, 1023 is 70 rpm
+DYNAMIXEL_SERVO_MODEL(MODEL_MX_28, PidModel, "MX-28", 0.114, 2.06);         // 12V
+DYNAMIXEL_SERVO_MODEL(MODEL_MX_64, PidModel, "MX-64", 0.114, 6.0);          // 12V
+DYNAMIXEL_SERVO_MODEL(MODEL_MX_106, PidModel, "MX-106", 0.114, 8.4);        // 12V
+
+#undef DYNAMIXEL_SERVO_MODEL
+
+/**
+ * Scales of the model \a Model, see ServoConfiguration.
+ */
+template <class Model>
+struct ModelScales
+{
+    /** Angle range in rad. */
+    static double angleRange() { return Model::cAngleRange * 3.141592653589793 / 180.0; }
+    /** Rotation center in rad. */
+    static double positionOffset() { return angleRange() / 2.0; }
+    /** Steps per rad. */
+    static double positionScale() { return Model::cPositionMax / angleRange(); }
+    /** Converts rad/s to speed steps. */
+    static double speedScale() { return (60.0 / (2.0 * 3.141592653589793)) / Model::rpmPerStep(); }
+    /** Converts Nm to load steps. */
+    static double effortScale() { return Model::cSpeedLoadMax / Model::stallTorque(); }
+
+    /** pos_ticks = (pos_rad + positionOffset) * positionScale, clamped to the position range. */
+    static uint16_t positionToTicks(double position_)
+    {
+        double ticks = (position_ + positionOffset()) * positionScale() + 0.5;
+        return ticks < 0 ? 0 : (ticks > Model::cPositionMax ? Model::cPositionMax : (uint16_t)ticks);
+    }
+
+    static double ticksToPosition(uint16_t ticks_)
+    {
+        return ticks_ / positionScale() - positionOffset();
+    }
+};
+
+/**
+ * Runtime description of a model, used for mixed-model buses, see findModel().
+ */
+struct ModelInfo
+{
+    int modelNumber;
+    char const* name;
+    bool hasCompliance;
+    int positionMax;
+    double positionOffset;
+    double positionScale;
+    double speedScale;
+    double effortScale;
+};
+
+template <class Model>
+inline ModelInfo const& getModelInfo()
+{
+    typedef ModelScales<Model> Scales;
+    static ModelInfo const info = {Model::cModelNumber, Model::name(), Model::cHasCompliance,
+            Model::cPositionMax, Scales::positionOffset(), Scales::positionScale(),
+            Scales::speedScale(), Scales::effortScale()};
+    return info;
+}
+
+/**
+ * Returns the model with the Model Number \a model_number_ or NULL if it is unknown.
+ */
+inline ModelInfo const* findModel(int const model_number_)
+{
+    switch(model_number_)
+    {
+        case MODEL_AX_12: return &getModelInfo<ServoModel<MODEL_AX_12> >();
+        case MODEL_AX_18: return &getModelInfo<ServoModel<MODEL_AX_18> >();
+        case MODEL_RX_28: return &getModelInfo<ServoModel<MODEL_RX_28> >();
+        case MODEL_RX_64: return &getModelInfo<ServoModel<MODEL_RX_64> >();
+        case MODEL_DX_116: return &getModelInfo<ServoModel<MODEL_DX_116> >();
+        case MODEL_MX_28: return &getModelInfo<ServoModel<MODEL_MX_28> >();
+        case MODEL_MX_64: return &getModelInfo<ServoModel<MODEL_MX_64> >();
+        case MODEL_MX_106: return &getModelInfo<ServoModel<MODEL_MX_106> >();
+        default: return NULL;
+    }
+}
+
+}
+
+#endif
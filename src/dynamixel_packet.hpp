@@ -0,0 +1,196 @@
+#ifndef DYNAMIXEL_PACKET_HPP__
+#define DYNAMIXEL_PACKET_HPP__
+
+/**
+ * \file dynamixel_packet.hpp
+ *
+ * \brief   Header-only builders of Protocol 1.0 instruction packets.
+ *
+ * \details Values are encoded in little endian byte by byte, independent of the
+ *          host byte order. WritePacket<Reg> has a fixed shape: length, instruction
+ *          and address are compile time constants including their part of the
+ *          checksum, only the id, the value and the checksum are patched at runtime,
+ *          e.g.
+ *          \code
+ *          dx::WritePacket<dx::GoalPosition> packet;
+ *          driver.writePacket(packet.set(id, 512).data(), packet.size());
+ *          \endcode
+ *          PacketBuilder assembles packets of variable shape.
+ */
+
+#include <inttypes.h>
+
+extern "C" {
+#include "dxseries.h"
+}
+
+#include "dynamixel_registers.hpp"
+
+namespace dx {
+
+/**
+ * Stores the \a bytes_ (1 or 2) bytes of \a value_ in little endian to \a data_,
+ * returns the number of bytes. This is the only encoder of parameter values,
+ * with a constant \a bytes_ the branch is resolved at compile time.
+ */
+inline int putLittleEndian(uint8_t* data_, uint16_t const value_, int const bytes_)
+{
+    data_[0] = value_ & 0xff;
+    if(bytes_ == 2)
+    {
+        data_[1] = (value_ >> 8) & 0xff;
+    }
+    return bytes_;
+}
+
+/**
+ * Instruction packet writing \a Bytes bytes to \a Address, e.g. DX_WRITE or DX_REGWRITE.
+ * Layout: 0xFF 0xFF ID LENGTH INSTRUCTION ADDRESS DATA... CHECKSUM
+ */
+template <int Address, int Bytes, int Instruction = DX_WRITE>
+class FixedWritePacket
+{
+ public:
+    static const int cSize = Bytes + 7;
+    static const int cLength = Bytes + 3;
+    /** Sum of the constant bytes covered by the checksum. */
+    static const int cConstantSum = (cLength + Instruction + Address) & 0xff;
+
+    FixedWritePacket()
+    {
+        mData[0] = 0xff;
+        mData[1] = 0xff;
+        mData[2] = 0;
+        mData[3] = cLength;
+        mData[4] = Instruction;
+        mData[5] = Address;
+    }
+
+    /**
+     * Patches the id, the value and the checksum, the constant header is kept.
+     */
+    inline FixedWritePacket& set(uint8_t const id_, uint16_t const value_)
+    {
+        patch(mData, id_, value_);
+        return *this;
+    }
+
+    inline uint8_t const* data() const
+    {
+        return mData;
+    }
+
+    inline int size() const
+    {
+        return cSize;
+    }
+
+    /**
+     * Writes the complete packet to \a buffer_ (cSize bytes) without loops.
+     */
+    static inline int encode(uint8_t* buffer_, uint8_t const id_, uint16_t const value_)
+    {
+        buffer_[0] = 0xff;
+        buffer_[1] = 0xff;
+        buffer_[2] = id_;
+        buffer_[3] = cLength;
+        buffer_[4] = Instruction;
+        buffer_[5] = Address;
+        patch(buffer_, id_, value_);
+        return cSize;
+    }
+
+ private:
+    /**
+     * Writes the id, the value and the checksum to \a buffer_.
+     */
+    static inline void patch(uint8_t* buffer_, uint8_t const id_, uint16_t const value_)
+    {
+        buffer_[2] = id_;
+        putLittleEndian(buffer_ + 6, value_, Bytes);
+        uint8_t checksum = cConstantSum + id_ + (value_ & 0xff);
+        if(Bytes == 2)
+        {
+            checksum += (value_ >> 8) & 0xff;
+        }
+        buffer_[6 + Bytes] = ~checksum;
+    }
+
+    uint8_t mData[cSize];
+};
+
+/**
+ * Fixed-shape WRITE (or REG_WRITE) of the control table entry \a Reg.
+ */
+template <class Reg, int Instruction = DX_WRITE>
+class WritePacket : public FixedWritePacket<Reg::address, Reg::bytes, Instruction>
+{
+};
+
+/**
+ * Builds an instruction packet of variable shape into a caller buffer, the checksum
+ * is summed up while the parameters are added, see finish().
+ */
+class PacketBuilder
+{
+ public:
+    /**
+     * \param buffer_ Has to provide 6 bytes plus the parameters.
+     */
+    PacketBuilder(uint8_t* buffer_, uint8_t const id_, uint8_t const instruction_)
+            : mBuffer(buffer_), mSize(5), mChecksum(id_ + instruction_)
+    {
+        mBuffer[0] = 0xff;
+        mBuffer[1] = 0xff;
+        mBuffer[2] = id_;
+        mBuffer[4] = instruction_;
+    }
+
+    inline PacketBuilder& add8(uint8_t const value_)
+    {
+        mBuffer[mSize++] = value_;
+        mChecksum += value_;
+        return *this;
+    }
+
+    /**
+     * Adds \a value_ in little endian.
+     */
+    inline PacketBuilder& add16(uint16_t const value_)
+    {
+        return add(value_, 2);
+    }
+
+    /**
+     * Adds \a bytes_ (1 or 2) bytes of \a value_, see putLittleEndian().
+     */
+    inline PacketBuilder& add(uint16_t const value_, int const bytes_)
+    {
+        int size = putLittleEndian(mBuffer + mSize, value_, bytes_);
+        for(int i=0; i<size; i++)
+        {
+            mChecksum += mBuffer[mSize++];
+        }
+        return *this;
+    }
+
+    /**
+     * Sets the length and the checksum, returns the size of the packet.
+     */
+    inline int finish()
+    {
+        uint8_t length = mSize - 4 + 1;
+        mBuffer[3] = length;
+        mBuffer[mSize] = ~(uint8_t)(mChecksum + length);
+        return mSize + 1;
+    }
+
+ private:
+    uint8_t* mBuffer;
+    int mSize;
+    uint8_t mChecksum;
+};
+
+} // end namespace dx
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef DYNAMIXEL_REGISTERS_HPP__
+#define DYNAMIXEL_REGISTERS_HPP__
+
+/**
+ * \file dynamixel_registers.hpp
+ *
+ * \brief   Compile time descriptors of the DX series control table entries.
+ *
+ * \details Every control table entry is a type carrying its number (index into the
+ *          control table, see Dynamixel::RegisterId), its address and its size in bytes,
+ *          e.g. dynamixel.set<dx::GoalPosition>(512). The rows of the control tables in
+ *          dynamixel_control_table.cpp are built from these descriptors.
+ *          A number always denotes the same address and size, registers of a model
+ *          at the address of another register (e.g. the PID gains of the MX series)
+ *          have their own number.
+ */
+
+namespace dx {
+
+template <int Number, int Address, int Bytes>
+struct Register
+{
+    static const int number = Number;
+    static const int address = Address;
+    static const int bytes = Bytes;
+};
+
+typedef Register< 0,  0, 2> ModelNumber;
+typedef Register< 1,  2, 1> FirmwareVersion;
+typedef Register< 2,  3, 1> ID;
+typedef Register< 3,  4, 1> BaudRate;
+typedef Register< 4,  5, 1> ReturnDelayTime;
+typedef Register< 5,  6, 2> CWAngleLimit;
+typedef Register< 6,  8, 2> CCWAngleLimit;
+typedef Register< 7, 11, 1> HighestLimitTemperature;
+typedef Register< 8, 12, 1> LowestLimitVoltage;
+typedef Register< 9, 13, 1> HighestLimitVoltage;
+typedef Register<10, 14, 2> MaxTorque;
+typedef Register<11, 16, 1> StatusReturnLevel;
+typedef Register<12, 17, 1> AlarmLED;
+typedef Register<13, 18, 1> AlarmShutdown;
+typedef Register<14, 20, 2> DownCalibration;
+typedef Register<15, 22, 2> UpCalibration;
+typedef Register<16, 24, 1> TorqueEnable;
+typedef Register<17, 25, 1> LED;
+typedef Register<18, 26, 1> CWComplianceMargin;
+typedef Register<19, 27, 1> CCWComplianceMargin;
+typedef Register<20, 28, 1> CWComplianceSlope;
+typedef Register<21, 29, 1> CCWComplianceSlope;
+typedef Register<22, 30, 2> GoalPosition;
+typedef Register<23, 32, 2> MovingSpeed;
+typedef Register<24, 34, 2> TorqueLimit;
+typedef Register<25, 36, 2> PresentPosition;
+typedef Register<26, 38, 2> PresentSpeed;
+typedef Register<27, 40, 2> PresentLoad;
+typedef Register<28, 42, 1> PresentVoltage;
+typedef Register<29, 43, 1> PresentTemperature;
+typedef Register<30, 44, 1> RegisteredInstruction;
+typedef Register<31, 46, 1> Moving;
+typedef Register<32, 47, 1> Lock;
+typedef Register<33, 48, 2> Punch;
+
+// MX series, at the addresses of the DX entries 14, 15 and 18 to 20 or behind them
+typedef Register<34, 68, 2> Current;
+typedef Register<35, 70, 1> TorqueControlModeEnable;
+typedef Register<36, 71, 2> GoalTorque;
+typedef Register<37, 73, 1> GoalAcceleration;
+typedef Register<38, 20, 2> MultiTurnOffset;
+typedef Register<39, 22, 1> ResolutionDivider;
+typedef Register<40, 26, 1> DGain;
+typedef Register<41, 27, 1> IGain;
+typedef Register<42, 28, 1> PGain;
+
+}
+
+#endif
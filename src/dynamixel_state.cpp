@@ -0,0 +1,56 @@
+#include "dynamixel_state.h"
+
+extern "C" {
+#include "dxseries.h"
+}
+
+#include "dynamixel_registers.hpp"
+
+int DynamixelStateStore::add(uint8_t const id_)
+{
+    mIDs.push_back(id_);
+    mPositions.push_back(0);
+    mSpeeds.push_back(0);
+    mLoads.push_back(0);
+    mVoltages.push_back(0);
+    mTemperatures.push_back(0);
+    mCurrents.push_back(0);
+    mVelocities.push_back(0);
+    mPositions2.push_back(0);
+    mErrors.push_back(0);
+    return mIDs.size() - 1;
+}
+
+void DynamixelStateStore::setControlTableValue(int const index_, int const number_, uint16_t const value_)
+{
+    switch(number_)
+    {
+        case dx::PresentPosition::number: mPositions[index_] = value_; break;
+        case dx::PresentSpeed::number: mSpeeds[index_] = value_; break;
+        case dx::PresentLoad::number: mLoads[index_] = value_; break;
+        case dx::PresentVoltage::number: mVoltages[index_] = value_; break;
+        case dx::PresentTemperature::number: mTemperatures[index_] = value_; break;
+        default: break;
+    }
+}
+
+void DynamixelStateStore::setPresentValues2(int const index_, Dx2PresentValues const& values_)
+{
+    mCurrents[index_] = values_.presentCurrent;
+    mVelocities[index_] = values_.presentVelocity;
+    mPositions2[index_] = values_.presentPosition;
+}
+
+void DynamixelStateStore::setErrorStatus(int const index_, servo_dynamixel::ErrorStatus const& status)
+{
+    uint8_t bits = 0;
+    if(status.inputVoltageError) bits |= DX_INPUT_VOLTAGE_ERROR;
+    if(status.angleLimitError) bits |= DX_ANGLE_LIMIT_ERROR;
+    if(status.overheatingError) bits |= DX_OVERHEATING_ERROR;
+    if(status.rangeError) bits |= DX_RANGE_ERROR;
+    if(status.checksumError) bits |= DX_CHECKSUM_ERROR;
+    if(status.overloadError) bits |= DX_OVERLOAD_ERROR;
+    if(status.instructionError) bits |= DX_INSTRUCTION_ERROR;
+    if(status.hardwareError) bits |= cHardwareError;
+    mErrors[index_] = bits;
+}
@@ -0,0 +1,124 @@
+/**
+ * \file dynamixel_state.h
+ *
+ * \brief   Stores the present values of all servos as structure of arrays.
+ *
+ * \details Every value (position, speed, ...) of all servos is kept in one contiguous
+ *          array, ordered like the servos have been added. Controllers can access e.g.
+ *          all positions without gathering them from the single Servo objects or
+ *          copying the servo list, see DynamixelStateStore::positions().
+ *          The arrays contain the raw register values, positions(), speeds(), loads(),
+ *          voltages() and temperatures() are filled by Protocol 1.0 reads,
+ *          currents(), velocities() and positions2() by Protocol 2.0 reads.
+ */
+
+#ifndef DYNAMIXEL_STATE_H_
+#define DYNAMIXEL_STATE_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include "dynamixel_types.hpp"
+
+extern "C" {
+#include "dxseries2.h"
+}
+
+/**
+ * \class ArrayView
+ * Read-only view of a contiguous array, does not copy the data.
+ * The view becomes invalid if servos are added.
+ */
+template <class T>
+class ArrayView
+{
+ public:
+    ArrayView(T const* data_, size_t size_) : mData(data_), mSize(size_) {}
+
+    inline T const* data() const { return mData; }
+    inline size_t size() const { return mSize; }
+    inline bool empty() const { return mSize == 0; }
+    inline T const& operator[](size_t i) const { return mData[i]; }
+    inline T const* begin() const { return mData; }
+    inline T const* end() const { return mData + mSize; }
+
+ private:
+    T const* mData;
+    size_t mSize;
+};
+
+/**
+ * \class DynamixelStateStore
+ * See file description for details.
+ */
+class DynamixelStateStore
+{
+ public:
+    /**
+     * Bit within errors() marking the Protocol 2.0 hardware alert,
+     * the other bits are the DX_*_ERROR flags of dxseries.h.
+     */
+    static uint8_t const cHardwareError = 0x80;
+
+    /**
+     * Adds a servo and returns its index within the arrays.
+     */
+    int add(uint8_t const id_);
+
+    /**
+     * Number of servos.
+     */
+    inline size_t size() const
+    {
+        return mIDs.size();
+    }
+
+    inline ArrayView<uint8_t> ids() const { return view(mIDs); }
+    inline ArrayView<uint16_t> positions() const { return view(mPositions); }
+    inline ArrayView<uint16_t> speeds() const { return view(mSpeeds); }
+    inline ArrayView<uint16_t> loads() const { return view(mLoads); }
+    inline ArrayView<uint8_t> voltages() const { return view(mVoltages); }
+    inline ArrayView<uint8_t> temperatures() const { return view(mTemperatures); }
+    inline ArrayView<int16_t> currents() const { return view(mCurrents); }
+    inline ArrayView<int32_t> velocities() const { return view(mVelocities); }
+    inline ArrayView<int32_t> positions2() const { return view(mPositions2); }
+    inline ArrayView<uint8_t> errors() const { return view(mErrors); }
+
+    /**
+     * Stores the control table value \a value_ of the entry \a number_
+     * (Dynamixel::RegisterId) if it is part of the present state.
+     */
+    void setControlTableValue(int const index_, int const number_, uint16_t const value_);
+
+    /**
+     * Stores the Protocol 2.0 present values \a values_.
+     */
+    void setPresentValues2(int const index_, Dx2PresentValues const& values_);
+
+    /**
+     * Stores the error bits of \a status.
+     */
+    void setErrorStatus(int const index_, servo_dynamixel::ErrorStatus const& status);
+
+ private:
+    template <class T>
+    static ArrayView<T> view(std::vector<T> const& vector_)
+    {
+        return ArrayView<T>(vector_.empty() ? NULL : &vector_[0], vector_.size());
+    }
+
+    std::vector<uint8_t> mIDs;
+    std::vector<uint16_t> mPositions;
+    std::vector<uint16_t> mSpeeds;
+    std::vector<uint16_t> mLoads;
+    std::vector<uint8_t> mVoltages;
+    std::vector<uint8_t> mTemperatures;
+    std::vector<int16_t> mCurrents;
+    std::vector<int32_t> mVelocities;
+    std::vector<int32_t> mPositions2;
+    std::vector<uint8_t> mErrors;
+};
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * \file dynamixel_status.h
+ *
+ * \brief   Read-only view of a received Protocol 1.0 status packet.
+ *
+ * \details The view points into the receive buffer and decodes the fields on
+ *          access, nothing is copied. Multi byte values are little endian on the
+ *          bus and are assembled byte by byte, so the host byte order does not matter.
+ *          Packet layout: 0xFF 0xFF ID LENGTH ERROR PARAMETERS... CHECKSUM
+ */
+
+#ifndef DYNAMIXEL_STATUS_H_
+#define DYNAMIXEL_STATUS_H_
+
+#include <inttypes.h>
+
+/**
+ * \class StatusPacket
+ * See file description for details.
+ */
+class StatusPacket
+{
+ public:
+    /** 0xFF 0xFF ID LENGTH ERROR */
+    static int const cHeaderSize = 5;
+
+    /**
+     * \param data_ Start of the packet, has to stay valid while the view is used.
+     * \param size_ Number of received bytes.
+     */
+    StatusPacket(uint8_t const* data_, int const size_) : mData(data_), mSize(size_) {}
+
+    /**
+     * True if the packet is complete and the checksum is correct.
+     */
+    bool isValid() const
+    {
+        if(mSize < cHeaderSize + 1 || mData[0] != 0xff || mData[1] != 0xff ||
+                mData[3] < 2 || mSize < mData[3] + 4)
+        {
+            return false;
+        }
+        uint8_t checksum = 0;
+        for(int i=2; i<mData[3] + 3; i++)
+        {
+            checksum += mData[i];
+        }
+        return (uint8_t)~checksum == mData[mData[3] + 3];
+    }
+
+    inline uint8_t getID() const
+    {
+        return mData[2];
+    }
+
+    /**
+     * Error bits, see DX_*_ERROR in dxseries.h.
+     */
+    inline uint8_t getErrorFlags() const
+    {
+        return mData[4];
+    }
+
+    /**
+     * Number of parameters (bytes read from the control table).
+     */
+    inline int getParameterCount() const
+    {
+        return mData[3] - 2;
+    }
+
+    inline uint8_t const* getParameters() const
+    {
+        return mData + cHeaderSize;
+    }
+
+    /**
+     * Returns the parameter at \a offset_.
+     */
+    inline uint8_t getUInt8(int const offset_) const
+    {
+        return mData[cHeaderSize + offset_];
+    }
+
+    /**
+     * Returns the little endian value of the parameters at \a offset_ and \a offset_ + 1.
+     */
+    inline uint16_t getUInt16(int const offset_) const
+    {
+        return mData[cHeaderSize + offset_] | (mData[cHeaderSize + offset_ + 1] << 8);
+    }
+
+    /**
+     * Returns the value of \a bytes_ (1 or 2) parameters at \a offset_.
+     */
+    inline uint16_t getValue(int const offset_, int const bytes_) const
+    {
+        return bytes_ == 2 ? getUInt16(offset_) : getUInt8(offset_);
+    }
+
+    /**
+     * True if the parameters, read starting at the control table address \a start_address_,
+     * contain the \a bytes_ bytes at \a address_.
+     */
+    inline bool contains(int const start_address_, int const address_, int const bytes_) const
+    {
+        return address_ >= start_address_ && address_ + bytes_ <= start_address_ + getParameterCount();
+    }
+
+    /**
+     * Returns the control table entry \a Reg (e.g. dx::PresentPosition), the parameters
+     * have been read starting at \a start_address_. See contains().
+     */
+    template <class Reg>
+    uint16_t get(int const start_address_) const
+    {
+        return getValue(Reg::address - start_address_, Reg::bytes);
+    }
+
+ private:
+    uint8_t const* mData;
+    int mSize;
+};
+
+#endif
@@ -5,6 +5,8 @@
 #include <inttypes.h>
 #include <stdexcept>
 
+#include "dynamixel_models.hpp"
+
 namespace servo_dynamixel {
 
     
@@ -24,6 +26,8 @@ struct ErrorStatus
     bool checksumError;
     bool overloadError;
     bool instructionError;
+    /** Protocol 2.0 only: the hardware error status register of the servo has to be checked */
+    bool hardwareError;
 
     void clear()
     {
@@ -34,6 +38,7 @@ struct ErrorStatus
 	checksumError = false;
 	overloadError = false;
 	instructionError = false;
+	hardwareError = false;
     }
 
     bool hasError()
@@ -45,13 +50,20 @@ struct ErrorStatus
 	    rangeError ||
 	    checksumError ||
 	    overloadError ||
-	    instructionError;
+	    instructionError ||
+	    hardwareError;
     }
 };
 
 enum DYNAMIXEL_TYPE {
     DYN_DX_116,
     DYN_MX_28,
+    DYN_AX_12,
+    DYN_AX_18,
+    DYN_RX_28,
+    DYN_RX_64,
+    DYN_MX_64,
+    DYN_MX_106
 };
 
 /**
@@ -198,39 +210,37 @@ struct ServoConfiguration
     
     /**
      * Contains the predefined scales and position ranges
-     * for some dynamixels.
+     * for some dynamixels, see dynamixel_models.hpp.
      */
     void setScales(enum DYNAMIXEL_TYPE type) {
         switch(type) {
-            case DYN_DX_116: {
-                // Sets the rotation center in rad.
-                positionOffset = (300/180)*PI/2.0;
-                // 0° to 300° with 1024 steps.
-                positionRange = 1023;
-                // Calculates steps per rad.
-                positionScale = positionRange/((300/180)*PI);
-                // Converts rad/sec to DX speed value: 0~1023 (0X3FF). 1023 is 70 rpm.
-                speedScale = ((60/(2*PI)) / 70) * 1023;
-                // 2.5Nm with 12V
-                effortScale = 1023/2.5;
-                break;
-            }
-            case DYN_MX_28: {
-                // Sets the rotation center in rad.
-                positionOffset = ((360/180)*PI)/2.0;
-                // 0° to 360° with 4096 steps.
-                positionRange = 4095;
-                // Calculates steps per rad.
-                positionScale = positionRange/((360/180)*PI);
-                // Converts rad/sec to MX speed value: 0~1023 (0X3FF) with 0.114rpm per step. 
-                // 0 is maximum. 1023 is 117.07 rpm.
-                speedScale = ((60/(2*PI)) / 117.07) * 1023;
-                // 2.06Nm with 12V
-                effortScale = 1023/2.06;
-                break;
-            }
+            case DYN_DX_116: setScales(getModelInfo<ServoModel<MODEL_DX_116> >()); break;
+            case DYN_MX_28: setScales(getModelInfo<ServoModel<MODEL_MX_28> >()); break;
+            case DYN_AX_12: setScales(getModelInfo<ServoModel<MODEL_AX_12> >()); break;
+            case DYN_AX_18: setScales(getModelInfo<ServoModel<MODEL_AX_18> >()); break;
+            case DYN_RX_28: setScales(getModelInfo<ServoModel<MODEL_RX_28> >()); break;
+            case DYN_RX_64: setScales(getModelInfo<ServoModel<MODEL_RX_64> >()); break;
+            case DYN_MX_64: setScales(getModelInfo<ServoModel<MODEL_MX_64> >()); break;
+            case DYN_MX_106: setScales(getModelInfo<ServoModel<MODEL_MX_106> >()); break;
         }
     }
+
+    /**
+     * Sets the scales of \a model, e.g. findModel() of the Model Number
+     * read from the servo.
+     */
+    void setScales(ModelInfo const& model) {
+        // Sets the rotation center in rad.
+        positionOffset = model.positionOffset;
+        // e.g. 0° to 300° with 1024 steps.
+        positionRange = model.positionMax;
+        // Calculates steps per rad.
+        positionScale = model.positionScale;
+        // Converts rad/sec to the speed value: 0~1023 (0X3FF).
+        speedScale = model.speedScale;
+        // Load value 1023 is the stall torque.
+        effortScale = model.effortScale;
+    }
 };
 
 }
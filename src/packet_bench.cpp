@@ -0,0 +1,121 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <iostream>
+
+#include "dynamixel_packet.hpp"
+
+static volatile uint8_t sSink = 0;
+
+static double nanosecondsPerPacket(clock_t const start_, long const iterations_)
+{
+    return (double)(clock() - start_) * 1e9 / CLOCKS_PER_SEC / iterations_;
+}
+
+static int verify()
+{
+    uint8_t expected[32];
+    uint8_t packet[32];
+    int mismatches = 0;
+    for(int id=0; id<DX_BROADCAST; id++)
+    {
+        for(long value=0; value<=0xffff; value++)
+        {
+            DX_UINT8 size;
+            DX_UINT8 data[2] = {(DX_UINT8)(value & 0xff), (DX_UINT8)(value >> 8)};
+            dxGetWriteCommand(expected, &size, id, dx::GoalPosition::address, data, 2);
+            if(dx::WritePacket<dx::GoalPosition>::encode(packet, id, value) != size ||
+                    memcmp(expected, packet, size) != 0)
+            {
+                mismatches++;
+            }
+            dx::WritePacket<dx::GoalPosition> fixed;
+            if(memcmp(expected, fixed.set(id, value).data(), size) != 0)
+            {
+                mismatches++;
+            }
+            if(dx::PacketBuilder(packet, id, DX_WRITE).add8(dx::GoalPosition::address).
+                    add16(value).finish() != size || memcmp(expected, packet, size) != 0)
+            {
+                mismatches++;
+            }
+
+            dxGetWriteCommand(expected, &size, id, dx::TorqueEnable::address, data, 1);
+            if(dx::WritePacket<dx::TorqueEnable>::encode(packet, id, value) != size ||
+                    memcmp(expected, packet, size) != 0)
+            {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * Compares the packet builders of dynamixel_packet.hpp with dxGetWriteCommand().\n
+ * Usage: ./dynamixel_packet_bench [iterations] \n
+ * First verifies that all builders produce the same bytes for every id and value
+ * (WRITE of dx::GoalPosition and dx::TorqueEnable), then prints the time per
+ * goal position packet of each builder. Build with -O2.
+ * \return 0 if success, 1 if a builder produced a different packet
+ */
+int main(int argc, char** argv)
+{
+    long iterations = 100000000;
+    if(argc > 1)
+    {
+        iterations = atol(argv[1]);
+    }
+    if(iterations <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [iterations]" << std::endl;
+        return 1;
+    }
+
+    int mismatches = verify();
+    if(mismatches != 0)
+    {
+        std::cerr << mismatches << " packets differ from dxGetWriteCommand()" << std::endl;
+        return 1;
+    }
+    std::cout << "All packets are identical to dxGetWriteCommand()" << std::endl;
+
+    uint8_t packet[32];
+    clock_t start = clock();
+    for(long i=0; i<iterations; i++)
+    {
+        DX_UINT8 size;
+        DX_UINT8 data[2] = {(DX_UINT8)i, (DX_UINT8)(i >> 8)};
+        dxGetWriteCommand(packet, &size, i & 0x7f, dx::GoalPosition::address, data, 2);
+        sSink += packet[8];
+    }
+    std::cout << "dxGetWriteCommand:      " << nanosecondsPerPacket(start, iterations) << " ns" << std::endl;
+
+    start = clock();
+    for(long i=0; i<iterations; i++)
+    {
+        dx::WritePacket<dx::GoalPosition>::encode(packet, i & 0x7f, (uint16_t)i);
+        sSink += packet[8];
+    }
+    std::cout << "WritePacket::encode:    " << nanosecondsPerPacket(start, iterations) << " ns" << std::endl;
+
+    dx::WritePacket<dx::GoalPosition> fixed;
+    start = clock();
+    for(long i=0; i<iterations; i++)
+    {
+        sSink += fixed.set(i & 0x7f, (uint16_t)i).data()[8];
+    }
+    std::cout << "WritePacket::set:       " << nanosecondsPerPacket(start, iterations) << " ns" << std::endl;
+
+    start = clock();
+    for(long i=0; i<iterations; i++)
+    {
+        dx::PacketBuilder(packet, i & 0x7f, DX_WRITE).add8(dx::GoalPosition::address).
+                add16((uint16_t)i).finish();
+        sSink += packet[8];
+    }
+    std::cout << "PacketBuilder:          " << nanosecondsPerPacket(start, iterations) << " ns" << std::endl;
+    return 0;
+}
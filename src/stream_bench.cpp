@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "dynamixel_iodriver.h"
+
+/**
+ * Gives access to the framing of DynamixelIODriver without a device.
+ */
+class StreamFramer : public DynamixelIODriver
+{
+ public:
+    int extract(uint8_t const* buffer_, size_t buffer_size_) const
+    {
+        return extractPacket(buffer_, buffer_size_);
+    }
+};
+
+static double cpuSeconds()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/**
+ * Appends status packets with 8 parameters of random servos to \a stream_ until it
+ * has \a size_ bytes. Before a packet a burst of up to 40 random bytes (a quarter
+ * of them 0xFF) is inserted with the probability \a noise_.
+ * \return number of status packets
+ */
+static long generateStream(std::vector<uint8_t>& stream_, int const protocol_,
+        double const noise_, size_t const size_)
+{
+    DX_UINT8 params[9] = {0, 1, 2, 3, 4, 5, 6, 7, 8}; // error and 8 bytes of data
+    DX_UINT8 packet[32];
+    long packets = 0;
+    while(stream_.size() < size_)
+    {
+        if(rand() < noise_ * RAND_MAX)
+        {
+            int burst = rand() % 40;
+            for(int i=0; i<burst; i++)
+            {
+                stream_.push_back(rand() % 4 == 0 ? 0xFF : rand() & 0xFF);
+            }
+        }
+        DX_UINT8 id = rand() % 20;
+        if(protocol_ == 1)
+        {
+            // FF FF ID LEN ERR PARAMS CHK
+            packet[0] = 0xFF;
+            packet[1] = 0xFF;
+            packet[2] = id;
+            packet[3] = sizeof(params) + 1;
+            DX_UINT8 checksum = id + packet[3];
+            for(unsigned int i=0; i<sizeof(params); i++)
+            {
+                packet[4 + i] = params[i];
+                checksum += params[i];
+            }
+            packet[4 + sizeof(params)] = ~checksum;
+            stream_.insert(stream_.end(), packet, packet + sizeof(params) + 5);
+        }
+        else
+        {
+            DX_UINT16 size;
+            dx2GetCommand(packet, &size, id, DX2_STATUS, params, sizeof(params));
+            stream_.insert(stream_.end(), packet, packet + size);
+        }
+        ++packets;
+    }
+    return packets;
+}
+
+/**
+ * Measures the status packet framing of DynamixelIODriver::extractPacket() on a
+ * noisy byte stream.\n
+ * Usage: ./dynamixel_stream_bench [protocol] [noise] [max chunk] [recorded stream] \n
+ * Without a file 20 MB of status packets of \a protocol (1 or 2, default 1) with noise
+ * bursts before a fraction \a noise (default 0.3) of the packets are generated. A file,
+ * e.g. captured with cat from the serial port, is replayed instead. The stream is fed
+ * in chunks of 1 to \a max chunk (default 16) bytes like iodrivers_base does, so an
+ * incomplete packet is examined several times.
+ * \return 0 if success, 1 if the arguments or the file are invalid
+ */
+int main(int argc, char** argv)
+{
+    int protocol = argc > 1 ? atoi(argv[1]) : 1;
+    double noise = argc > 2 ? atof(argv[2]) : 0.3;
+    int max_chunk = argc > 3 ? atoi(argv[3]) : 16;
+    if((protocol != 1 && protocol != 2) || noise < 0 || noise > 1 || max_chunk <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [protocol] [noise] [max chunk] [recorded stream]" << std::endl;
+        return 1;
+    }
+
+    srand(1);
+    std::vector<uint8_t> stream;
+    long generated = 0;
+    if(argc > 4)
+    {
+        FILE* file = fopen(argv[4], "rb");
+        if(file == NULL)
+        {
+            perror(argv[4]);
+            return 1;
+        }
+        uint8_t buffer[4096];
+        size_t read;
+        while((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            stream.insert(stream.end(), buffer, buffer + read);
+        }
+        fclose(file);
+    }
+    else
+    {
+        generated = generateStream(stream, protocol, noise, 20000000);
+    }
+    if(stream.empty())
+    {
+        std::cerr << "The stream is empty" << std::endl;
+        return 1;
+    }
+
+    StreamFramer framer;
+    framer.setProtocol(protocol == 1 ? DynamixelIODriver::PROTOCOL_1 : DynamixelIODriver::PROTOCOL_2);
+    size_t start = 0;
+    size_t end = 0;
+    long packets = 0;
+    size_t skipped = 0;
+    double begin = cpuSeconds();
+    while(end < stream.size())
+    {
+        size_t chunk = 1 + rand() % max_chunk;
+        end = std::min(end + chunk, stream.size());
+        while(start < end)
+        {
+            int result = framer.extract(&stream[start], end - start);
+            if(result == 0)
+            {
+                break;
+            }
+            if(result < 0)
+            {
+                start += -result;
+                skipped += -result;
+            }
+            else
+            {
+                start += result;
+                ++packets;
+            }
+        }
+    }
+    double seconds = cpuSeconds() - begin;
+
+    std::cout << "Protocol " << protocol << ", " << stream.size() << " bytes: " << seconds << " s, "
+            << stream.size() / seconds / 1e6 << " MB/s" << std::endl;
+    std::cout << packets << " packets";
+    if(generated > 0)
+    {
+        std::cout << " of " << generated << " (" << 100.0 * packets / generated << "%)";
+    }
+    std::cout << ", " << skipped << " bytes skipped" << std::endl;
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "dynamixel_iodriver.h"
+
+static double cpuSeconds()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/**
+ * Compares the CPU time of a timed out readPacket() (exception) with a timed out
+ * tryReadPacket() (TransferResult).\n
+ * Usage: ./dynamixel_transfer_bench [iterations] \n
+ * Both wait 1 us for a status packet on a pipe which never receives data, like
+ * polling a servo which does not answer, so mostly the failure handling is measured.
+ * \return 0 if success, 1 if the pipe could not be created
+ */
+int main(int argc, char** argv)
+{
+    long iterations = 200000;
+    if(argc > 1)
+    {
+        iterations = atol(argv[1]);
+    }
+    if(iterations <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [iterations]" << std::endl;
+        return 1;
+    }
+
+    int pipe_fds[2];
+    if(pipe(pipe_fds) != 0)
+    {
+        perror("pipe");
+        return 1;
+    }
+    fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+    DynamixelIODriver driver;
+    driver.setFileDescriptor(pipe_fds[0]);
+
+    uint8_t buffer[512];
+    base::Time const timeout = base::Time::fromMicroseconds(1);
+    long timeouts = 0;
+    double start = cpuSeconds();
+    for(long i=0; i<iterations; i++)
+    {
+        try {
+            driver.readPacket(buffer, sizeof(buffer), timeout);
+        } catch(iodrivers_base::TimeoutError& e) {
+            timeouts++;
+        }
+    }
+    double exception_us = (cpuSeconds() - start) / iterations * 1e6;
+    std::cout << "readPacket:    " << exception_us << " us per timeout (" << timeouts << " timeouts)" << std::endl;
+
+    timeouts = 0;
+    start = cpuSeconds();
+    for(long i=0; i<iterations; i++)
+    {
+        int packet_size;
+        if(driver.tryReadPacket(buffer, sizeof(buffer), timeout, packet_size) ==
+                DynamixelIODriver::TRANSFER_TIMEOUT)
+        {
+            timeouts++;
+        }
+    }
+    double result_us = (cpuSeconds() - start) / iterations * 1e6;
+    std::cout << "tryReadPacket: " << result_us << " us per timeout (" << timeouts << " timeouts)" << std::endl;
+
+    close(pipe_fds[1]);
+    return 0;
+}